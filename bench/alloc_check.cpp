@@ -0,0 +1,196 @@
+/*
+ * Steady-state allocation check for the runtime's dispatch path.
+ *
+ * Built as a shared object that is both preloaded into mock_runtime, where its malloc family counts every heap
+ * allocation in the process, and launched as the application. After warming up (FFT plans, thread caches, pools), it
+ * repeats a fixed round of kernel calls that goes through every pooled path: blocking and async calls, calls large
+ * enough to be split, batched calls and a resubmitted task graph. Any allocation during those rounds fails the check,
+ * and the runtime exits non-zero.
+ *
+ * Usage: LD_PRELOAD=alloc_check.so mock_runtime -I off [options] alloc_check.so [instances] [key=value ...]
+ *   warmup=<n>   rounds before counting (default: 50)
+ *   rounds=<n>   counted rounds (default: 20)
+ * Inlining must be off so that every call is handed to a worker.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "dash.h"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+}
+
+// Heap allocations made by any thread since the process started
+static std::atomic<size_t> allocations(0);
+
+static inline void count_allocation() { allocations.fetch_add(1, std::memory_order_relaxed); }
+
+extern "C" {
+void* malloc(size_t size) {
+  count_allocation();
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+  count_allocation();
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) {
+  count_allocation();
+  return __libc_realloc(pointer, size);
+}
+
+void free(void* pointer) { __libc_free(pointer); }
+
+void* memalign(size_t alignment, size_t size) {
+  count_allocation();
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  count_allocation();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) {
+  count_allocation();
+  *pointer = __libc_memalign(alignment, size);
+  return (*pointer == nullptr) ? ENOMEM : 0;
+}
+}
+
+struct alloc_check_config_t {
+  int warmup = 50;
+  int rounds = 20;
+};
+
+static bool parse_args(int argc, char** argv, alloc_check_config_t* config) {
+  for (int i = 1; i < argc; i++) {
+    const char* value = strchr(argv[i], '=');
+    if (value == nullptr) {
+      return false;
+    }
+    std::string key(argv[i], value - argv[i]);
+    value++;
+    if (key == "warmup") {
+      config->warmup = atoi(value);
+    } else if (key == "rounds") {
+      config->rounds = atoi(value);
+    } else {
+      return false;
+    }
+  }
+  return config->warmup > 0 && config->rounds > 0;
+}
+
+// Small problems keep the check quick; only the large ZIP is big enough to be split at the default split threshold
+#define CHECK_FFT_SIZE 64
+#define CHECK_GEMM_SIZE 32
+#define CHECK_ZIP_SIZE (1 << 14)
+#define CHECK_SPLIT_ZIP_SIZE (1 << 20)
+#define CHECK_BATCH 16
+#define CHECK_ASYNC_CALLS 32
+
+struct check_buffers_t {
+  double* fft_in;
+  double* fft_out;
+  double* gemm[6];
+  double* zip_in;
+  double* zip_out;
+  double* split_in;
+  double* split_out;
+};
+
+static double* alloc_filled(size_t elements, double value) {
+  double* buffer = (double*) DASH_alloc(elements * sizeof(double));
+  if (buffer == nullptr) {
+    fprintf(stderr, "[alloc_check] Unable to allocate %zu doubles\n", elements);
+    exit(1);
+  }
+  std::fill(buffer, buffer + elements, value);
+  return buffer;
+}
+
+// One round of calls; everything it needs was allocated up front
+static void run_round(check_buffers_t* b, dash_graph_t graph, dash_req_t* requests) {
+  const size_t n = CHECK_GEMM_SIZE;
+  DASH_FFT(b->fft_in, b->fft_out, CHECK_FFT_SIZE, true);
+  DASH_GEMM(b->gemm[0], b->gemm[1], b->gemm[2], b->gemm[3], b->gemm[4], b->gemm[5], n, n, n);
+  DASH_ZIP(b->zip_in, b->zip_in, b->zip_out, CHECK_ZIP_SIZE, ZIP_ADD);
+  DASH_ZIP(b->split_in, b->split_in, b->split_out, CHECK_SPLIT_ZIP_SIZE, ZIP_MULT);
+  for (size_t i = 0; i < CHECK_ASYNC_CALLS; i++) {
+    requests[i] = DASH_FFT_async(b->fft_in + 2 * CHECK_FFT_SIZE * i, b->fft_out + 2 * CHECK_FFT_SIZE * i, CHECK_FFT_SIZE,
+                                 true);
+  }
+  DASH_wait_all(requests, CHECK_ASYNC_CALLS);
+  DASH_FFT_BATCH(b->fft_in, b->fft_out, CHECK_FFT_SIZE, CHECK_BATCH, false);
+  DASH_wait(DASH_graph_submit(graph));
+}
+
+int main(int argc, char** argv) {
+  alloc_check_config_t config;
+  if (!parse_args(argc, argv, &config)) {
+    fprintf(stderr, "[alloc_check] Usage: alloc_check.so [warmup=n] [rounds=n]\n");
+    exit(1);
+  }
+
+  check_buffers_t b;
+  b.fft_in = alloc_filled(2 * CHECK_FFT_SIZE * CHECK_ASYNC_CALLS, 1.0);
+  b.fft_out = alloc_filled(2 * CHECK_FFT_SIZE * CHECK_ASYNC_CALLS, 0.0);
+  for (double*& matrix : b.gemm) {
+    matrix = alloc_filled(CHECK_GEMM_SIZE * CHECK_GEMM_SIZE, 0.5);
+  }
+  b.zip_in = alloc_filled(2 * CHECK_ZIP_SIZE, 1.0);
+  b.zip_out = alloc_filled(2 * CHECK_ZIP_SIZE, 0.0);
+  b.split_in = alloc_filled(2 * CHECK_SPLIT_ZIP_SIZE, 1.0);
+  b.split_out = alloc_filled(2 * CHECK_SPLIT_ZIP_SIZE, 0.0);
+  std::vector<dash_req_t> requests(CHECK_ASYNC_CALLS);
+
+  // Two independent FFT -> ZIP chains joined by a final ZIP
+  dash_graph_t graph = DASH_graph_create();
+  double* chain = b.fft_out + 2 * CHECK_FFT_SIZE * (CHECK_ASYNC_CALLS - 4);
+  DASH_graph_FFT(graph, b.fft_in, chain, CHECK_FFT_SIZE, true);
+  DASH_graph_FFT(graph, b.fft_in, chain + 2 * CHECK_FFT_SIZE, CHECK_FFT_SIZE, true);
+  DASH_graph_ZIP(graph, chain, chain, chain + 4 * CHECK_FFT_SIZE, CHECK_FFT_SIZE, ZIP_CMP_MULT);
+  DASH_graph_ZIP(graph, chain + 2 * CHECK_FFT_SIZE, chain, chain + 6 * CHECK_FFT_SIZE, CHECK_FFT_SIZE, ZIP_CMP_MULT);
+  DASH_graph_ZIP(graph, chain + 4 * CHECK_FFT_SIZE, chain + 6 * CHECK_FFT_SIZE, chain, 2 * CHECK_FFT_SIZE, ZIP_ADD);
+
+  for (int r = 0; r < config.warmup; r++) {
+    run_round(&b, graph, requests.data());
+  }
+  size_t before = allocations.load(std::memory_order_acquire);
+  for (int r = 0; r < config.rounds; r++) {
+    run_round(&b, graph, requests.data());
+  }
+  size_t delta = allocations.load(std::memory_order_acquire) - before;
+
+  DASH_graph_destroy(graph);
+  for (double* buffer : {b.fft_in, b.fft_out, b.zip_in, b.zip_out, b.split_in, b.split_out}) {
+    DASH_free(buffer);
+  }
+  for (double* matrix : b.gemm) {
+    DASH_free(matrix);
+  }
+
+  if (before == 0) {
+    fprintf(stderr, "[alloc_check] No allocations were counted at all; was alloc_check.so preloaded?\n");
+    exit(1);
+  }
+  printf("[alloc_check] %zu heap allocations in %d warmed-up rounds\n", delta, config.rounds);
+  if (delta != 0) {
+    fprintf(stderr, "[alloc_check] Steady-state dispatch allocated memory!\n");
+    exit(1);
+  }
+  return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Batched small-kernel benchmark.
+ *
+ * Built as a shared object that mock_runtime launches like any other application, so that every call pays the
+ * runtime's dispatch costs. Each round runs the same batch of small FFTs and of small GEMMs three ways: one blocking
+ * call per problem, one async call per problem followed by DASH_wait_all, and a single DASH_FFT_BATCH or
+ * DASH_GEMM_BATCH call. The best round of each is reported as time per problem.
+ *
+ * Usage: mock_runtime [options] batch_bench.so [instances] [key=value ...]
+ *   fft=<points>   FFT size (default: 256)
+ *   gemm=<n>       GEMM of two n x n complex matrices (default: 16)
+ *   batch=<n>      problems per batch (default: 1024)
+ *   rounds=<n>     rounds per variant (default: 20)
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "dash.h"
+
+struct batch_config_t {
+  size_t fft_size = 256;
+  size_t gemm_size = 16;
+  size_t batch = 1024;
+  int rounds = 20;
+};
+
+typedef std::chrono::steady_clock batch_clock;
+
+static bool parse_args(int argc, char** argv, batch_config_t* config) {
+  for (int i = 1; i < argc; i++) {
+    const char* value = strchr(argv[i], '=');
+    if (value == nullptr) {
+      return false;
+    }
+    std::string key(argv[i], value - argv[i]);
+    value++;
+    if (key == "fft") {
+      config->fft_size = strtoull(value, nullptr, 10);
+    } else if (key == "gemm") {
+      config->gemm_size = strtoull(value, nullptr, 10);
+    } else if (key == "batch") {
+      config->batch = strtoull(value, nullptr, 10);
+    } else if (key == "rounds") {
+      config->rounds = atoi(value);
+    } else {
+      return false;
+    }
+  }
+  return config->fft_size > 0 && config->gemm_size > 0 && config->batch > 0 && config->rounds > 0;
+}
+
+// Returns the best time per problem, in microseconds, of running one batch rounds times
+template <typename run_batch_t>
+static double best_per_problem_us(const batch_config_t& config, run_batch_t run_batch) {
+  // Warm up, which also builds the FFT plans and trains the runtime's cost model
+  run_batch();
+  double best = INFINITY;
+  for (int r = 0; r < config.rounds; r++) {
+    batch_clock::time_point start = batch_clock::now();
+    run_batch();
+    best = std::min(best, std::chrono::duration<double, std::micro>(batch_clock::now() - start).count());
+  }
+  return best / config.batch;
+}
+
+static double* alloc_filled(size_t elements, double value) {
+  double* buffer = (double*) DASH_alloc(elements * sizeof(double));
+  if (buffer == nullptr) {
+    fprintf(stderr, "[batch_bench] Unable to allocate %zu doubles\n", elements);
+    exit(1);
+  }
+  std::fill(buffer, buffer + elements, value);
+  return buffer;
+}
+
+static void print_row(const char* kernel, size_t size, double individual, double async, double batched) {
+  printf("[batch_bench] %-6s %6zu %16.2f %16.2f %16.2f %11.2fx\n", kernel, size, individual, async, batched,
+         individual / batched);
+}
+
+int main(int argc, char** argv) {
+  batch_config_t config;
+  if (!parse_args(argc, argv, &config)) {
+    fprintf(stderr, "[batch_bench] Usage: batch_bench.so [fft=n] [gemm=n] [batch=n] [rounds=n]\n");
+    return 1;
+  }
+  const size_t batch = config.batch;
+  std::vector<dash_req_t> requests(batch);
+
+  // FFTs: transforms stored back to back, transformed out of place
+  const size_t fft_length = 2 * config.fft_size;
+  double* fft_in = alloc_filled(fft_length * batch, 1.0);
+  double* fft_out = alloc_filled(fft_length * batch, 0.0);
+  double fft_individual = best_per_problem_us(config, [&]() {
+    for (size_t b = 0; b < batch; b++) {
+      DASH_FFT(fft_in + fft_length * b, fft_out + fft_length * b, config.fft_size, true);
+    }
+  });
+  double fft_async = best_per_problem_us(config, [&]() {
+    for (size_t b = 0; b < batch; b++) {
+      requests[b] = DASH_FFT_async(fft_in + fft_length * b, fft_out + fft_length * b, config.fft_size, true);
+    }
+    DASH_wait_all(requests.data(), batch);
+  });
+  double fft_batched = best_per_problem_us(config, [&]() {
+    DASH_FFT_BATCH(fft_in, fft_out, config.fft_size, batch, true);
+  });
+
+  // GEMMs: matrices of each operand stored back to back
+  const size_t gemm_elements = config.gemm_size * config.gemm_size;
+  double* a_re = alloc_filled(gemm_elements * batch, 1.0);
+  double* a_im = alloc_filled(gemm_elements * batch, 0.5);
+  double* b_re = alloc_filled(gemm_elements * batch, 0.5);
+  double* b_im = alloc_filled(gemm_elements * batch, 1.0);
+  double* c_re = alloc_filled(gemm_elements * batch, 0.0);
+  double* c_im = alloc_filled(gemm_elements * batch, 0.0);
+  const size_t n = config.gemm_size;
+  double gemm_individual = best_per_problem_us(config, [&]() {
+    for (size_t b = 0; b < batch; b++) {
+      size_t offset = gemm_elements * b;
+      DASH_GEMM(a_re + offset, a_im + offset, b_re + offset, b_im + offset, c_re + offset, c_im + offset, n, n, n);
+    }
+  });
+  double gemm_async = best_per_problem_us(config, [&]() {
+    for (size_t b = 0; b < batch; b++) {
+      size_t offset = gemm_elements * b;
+      requests[b] = DASH_GEMM_async(a_re + offset, a_im + offset, b_re + offset, b_im + offset, c_re + offset,
+                                    c_im + offset, n, n, n);
+    }
+    DASH_wait_all(requests.data(), batch);
+  });
+  double gemm_batched = best_per_problem_us(config, [&]() {
+    DASH_GEMM_BATCH(a_re, a_im, b_re, b_im, c_re, c_im, n, n, n, batch);
+  });
+
+  printf("[batch_bench] Batches of %zu problems, best of %d rounds (time per problem)\n", batch, config.rounds);
+  printf("[batch_bench] %-6s %6s %16s %16s %16s %12s\n", "kernel", "size", "individual (us)", "async (us)", "batched (us)",
+         "speedup");
+  print_row("FFT", config.fft_size, fft_individual, fft_async, fft_batched);
+  print_row("GEMM", config.gemm_size, gemm_individual, gemm_async, gemm_batched);
+
+  for (double* buffer : {fft_in, fft_out, a_re, a_im, b_re, b_im, c_re, c_im}) {
+    DASH_free(buffer);
+  }
+  return 0;
+}
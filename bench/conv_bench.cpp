@@ -0,0 +1,111 @@
+/*
+ * DASH_CONV_2D_cpu benchmark across image and mask sizes.
+ *
+ * For square images and masks, reports the time per call of the original implementation (bounds checks in the
+ * innermost loop) and of DASH_CONV_2D_cpu, for a general (random) mask and for a separable (Gaussian) one, along with
+ * the largest absolute difference from the original output. The original implementation is only timed while it takes
+ * a reasonable amount of work; larger cases print "-". Set DASH_CONV_ISA to compare instruction sets and
+ * DASH_CONV_FFT_MASK_SIZE to move the switch-over to FFT-based convolution.
+ *
+ * Usage: conv_bench [max image size]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "dash.h"
+
+extern "C" void DASH_CONV_2D_cpu(double** input, int* height, int* width, double** mask, int* mask_size, double** output);
+
+// Largest number of multiply-adds the original implementation is timed for
+#define BASELINE_MAX_WORK 4e8
+
+// DASH_CONV_2D_cpu as it was before the interior/border split
+static void baseline_conv_2d(double** input, int* height, int* width, double** mask, int* mask_size, double** output) {
+  int i, j, k, l;
+  int s, w;
+  int z;
+
+  z = (*mask_size) / 2;
+
+  for (i = 0; i < (*height); i++) {
+    for (j = 0; j < (*width); j++) {
+      (*output)[i * (*width) + j] = 0;
+      for (k = 0; k < (*mask_size); k++) {
+        for (l = 0; l < (*mask_size); l++) {
+          s = i + k - z;
+          w = j + l - z;
+          if ((s >= 0 && s < (*height)) && (w >= 0 && w < (*width))) {
+            (*output)[i * (*width) + j] += (*input)[(*width) * s + w] * (*mask)[(*mask_size) * k + l];
+          }
+        }
+      }
+    }
+  }
+}
+
+typedef void (*conv_function)(double**, int*, int*, double**, int*, double**);
+
+static double seconds_per_call(conv_function conv, double* input, int size, double* mask, int mask_size, double* output) {
+  int calls = 0;
+  auto start = std::chrono::steady_clock::now();
+  double elapsed;
+  do {
+    conv(&input, &size, &size, &mask, &mask_size, &output);
+    calls++;
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  } while (elapsed < 0.2);
+  return elapsed / calls;
+}
+
+static void bench_case(const std::vector<double>& image, int size, std::vector<double>& mask, int mask_size, const char* kind) {
+  std::vector<double> input(image), output(image.size()), expected(image.size());
+  double work = (double) size * size * mask_size * mask_size;
+
+  double fast = seconds_per_call(DASH_CONV_2D_cpu, input.data(), size, mask.data(), mask_size, output.data());
+  char baseline[32] = "-", speedup[32] = "-", max_error[32] = "-";
+  if (work <= BASELINE_MAX_WORK) {
+    double slow = seconds_per_call(baseline_conv_2d, input.data(), size, mask.data(), mask_size, expected.data());
+    double error = 0;
+    for (size_t i = 0; i < output.size(); i++) {
+      error = std::max(error, std::fabs(output[i] - expected[i]));
+    }
+    snprintf(baseline, sizeof(baseline), "%.3f", slow * 1e3);
+    snprintf(speedup, sizeof(speedup), "%.1fx", slow / fast);
+    snprintf(max_error, sizeof(max_error), "%.2e", error);
+  }
+  printf("%6d %6d %10s %14s %14.3f %10s %12s\n", size, mask_size, kind, baseline, fast * 1e3, speedup, max_error);
+}
+
+int main(int argc, char** argv) {
+  int max_size = (argc > 1) ? atoi(argv[1]) : 2048;
+  const char* isa = getenv("DASH_CONV_ISA");
+  const char* fft_mask_size = getenv("DASH_CONV_FFT_MASK_SIZE");
+  static const int mask_sizes[] = {3, 5, 9, 15, 25, 41, 63};
+
+  printf("DASH_CONV_2D_cpu benchmark (DASH_CONV_ISA=%s, DASH_CONV_FFT_MASK_SIZE=%s), ms per call\n", isa ? isa : "auto",
+         fft_mask_size ? fft_mask_size : "default");
+  printf("%6s %6s %10s %14s %14s %10s %12s\n", "image", "mask", "mask kind", "original", "DASH_CONV_2D", "speedup", "max error");
+  for (int size = 128; size <= max_size; size *= 4) {
+    std::vector<double> image((size_t) size * size);
+    for (size_t i = 0; i < image.size(); i++) {
+      image[i] = sin(0.001 * i) + (double) rand() / RAND_MAX;
+    }
+    for (int mask_size : mask_sizes) {
+      std::vector<double> general((size_t) mask_size * mask_size), gaussian((size_t) mask_size * mask_size);
+      double sigma = mask_size / 4.0;
+      for (int k = 0; k < mask_size; k++) {
+        for (int l = 0; l < mask_size; l++) {
+          double dk = k - mask_size / 2, dl = l - mask_size / 2;
+          general[k * mask_size + l] = (double) rand() / RAND_MAX - 0.5;
+          gaussian[k * mask_size + l] = exp(-(dk * dk) / (2 * sigma * sigma)) * exp(-(dl * dl) / (2 * sigma * sigma));
+        }
+      }
+      bench_case(image, size, general, mask_size, "general");
+      bench_case(image, size, gaussian, mask_size, "separable");
+    }
+  }
+  return 0;
+}
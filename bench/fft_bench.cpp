@@ -0,0 +1,84 @@
+/*
+ * DASH_FFT_cpu benchmark over transform sizes 64 to 65536.
+ *
+ * Compares the baseline implementation (scratch buffer malloc'd and copied every call, radix-2 only) against the
+ * plan-cached mixed-radix DASH_FFT_cpu, both out of place and in place. Non-power-of-two sizes are only supported
+ * by the latter.
+ *
+ * Usage: fft_bench [minimum transforms per size]
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <gsl/gsl_fft_complex.h>
+#include <vector>
+#include "dash.h"
+
+extern "C" void DASH_FFT_cpu(double** input, double** output, size_t* size, bool* isForwardTransform);
+
+// DASH_FFT_cpu as it was before FFT plans were cached
+static void baseline_fft(double** input, double** output, size_t* size, bool* isForwardTransform) {
+  double* data = (double*) malloc((*size) * 2 * sizeof(double));
+  for (size_t i = 0; i < (*size); i++) {
+    data[2 * i] = (*input)[2 * i];
+    data[(2 * i) + 1] = (*input)[(2 * i) + 1];
+  }
+  if (*isForwardTransform) {
+    gsl_fft_complex_radix2_forward(data, 1, (*size));
+  } else {
+    gsl_fft_complex_radix2_inverse(data, 1, (*size));
+  }
+  for (size_t i = 0; i < (*size); i++) {
+    (*output)[2 * i] = data[2 * i];
+    (*output)[(2 * i) + 1] = data[(2 * i) + 1];
+  }
+  free(data);
+}
+
+typedef void (*fft_function)(double**, double**, size_t*, bool*);
+
+// Returns the average time per transform in microseconds
+static double time_fft(fft_function fft, size_t size, int transforms, bool in_place) {
+  std::vector<double> input(2 * size), output(2 * size);
+  for (size_t i = 0; i < 2 * size; i++) {
+    input[i] = sin(0.01 * i);
+  }
+  double* in = input.data();
+  double* out = in_place ? input.data() : output.data();
+  bool forward = true;
+
+  // Warm up (and, for the cached implementation, build the plan)
+  fft(&in, &out, &size, &forward);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < transforms; t++) {
+    // Alternate directions so that in-place runs don't blow up numerically
+    forward = (t % 2) == 0;
+    fft(&in, &out, &size, &forward);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() / transforms;
+}
+
+int main(int argc, char** argv) {
+  int min_transforms = (argc > 1) ? atoi(argv[1]) : 20;
+  const size_t sizes[] = {64, 96, 128, 256, 500, 512, 1000, 1024, 2048, 4096, 4800, 8192, 16384, 32768, 48000, 65536};
+
+  printf("DASH_FFT_cpu benchmark (time per transform)\n");
+  printf("%8s %16s %16s %16s %12s\n", "size", "baseline (us)", "cached (us)", "in place (us)", "speedup");
+  for (size_t size : sizes) {
+    // Keep the total amount of work per size roughly constant
+    int transforms = std::max(min_transforms, (int) (4 * 1024 * 1024 / (size * log2((double) size))));
+    bool power_of_two = (size & (size - 1)) == 0;
+    double cached = time_fft(DASH_FFT_cpu, size, transforms, false);
+    double in_place = time_fft(DASH_FFT_cpu, size, transforms, true);
+    if (power_of_two) {
+      double baseline = time_fft(baseline_fft, size, transforms, false);
+      printf("%8zu %16.2f %16.2f %16.2f %11.2fx\n", size, baseline, cached, in_place, baseline / cached);
+    } else {
+      printf("%8zu %16s %16.2f %16.2f %12s\n", size, "unsupported", cached, in_place, "-");
+    }
+  }
+  return 0;
+}
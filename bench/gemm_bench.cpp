@@ -0,0 +1,104 @@
+/*
+ * DASH_GEMM_cpu benchmark for square and skinny shapes.
+ *
+ * Reports GFLOP/s (8 real flops per complex multiply-add) of the original naive triple loop and of the blocked
+ * DASH_GEMM_cpu, along with the largest absolute difference between their outputs. Set DASH_GEMM_ISA and
+ * DASH_GEMM_THREADS to compare microkernels and row-panel threading.
+ *
+ * Usage: gemm_bench [max square size]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "dash.h"
+
+extern "C" void DASH_GEMM_cpu(double** A_re, double** A_im, double** B_re, double** B_im, double** C_re, double** C_im, size_t* A_ROWS, size_t* A_COLS, size_t* B_COLS);
+
+// DASH_GEMM_cpu as it was before blocking and vectorization
+static void baseline_gemm(double** A_re, double** A_im, double** B_re, double** B_im, double** C_re, double** C_im, size_t* A_ROWS, size_t* A_COLS, size_t* B_COLS) {
+  for (size_t i = 0; i < (*A_ROWS); i++) {
+    for (size_t j = 0; j < (*B_COLS); j++) {
+      double res1 = 0, res2 = 0, res3 = 0, res4 = 0;
+      for (size_t k = 0; k < (*A_COLS); k++) {
+        res1 += (*A_re)[i * (*A_COLS) + k] * (*B_re)[k * (*B_COLS) + j];
+        res2 += (*A_im)[i * (*A_COLS) + k] * (*B_im)[k * (*B_COLS) + j];
+        res3 += (*A_re)[i * (*A_COLS) + k] * (*B_im)[k * (*B_COLS) + j];
+        res4 += (*A_im)[i * (*A_COLS) + k] * (*B_re)[k * (*B_COLS) + j];
+      }
+      (*C_re)[i * (*B_COLS) + j] = res1 - res2;
+      (*C_im)[i * (*B_COLS) + j] = res3 + res4;
+    }
+  }
+}
+
+typedef void (*gemm_function)(double**, double**, double**, double**, double**, double**, size_t*, size_t*, size_t*);
+
+struct gemm_problem {
+  size_t M, K, N;
+  std::vector<double> A_re, A_im, B_re, B_im, C_re, C_im;
+
+  gemm_problem(size_t m, size_t k, size_t n)
+      : M(m), K(k), N(n), A_re(m * k), A_im(m * k), B_re(k * n), B_im(k * n), C_re(m * n), C_im(m * n) {
+    for (size_t i = 0; i < m * k; i++) {
+      A_re[i] = sin(0.1 * i);
+      A_im[i] = cos(0.3 * i);
+    }
+    for (size_t i = 0; i < k * n; i++) {
+      B_re[i] = cos(0.2 * i);
+      B_im[i] = sin(0.7 * i);
+    }
+  }
+
+  // Returns GFLOP/s
+  double run(gemm_function gemm, int repetitions) {
+    double *a_re = A_re.data(), *a_im = A_im.data(), *b_re = B_re.data(), *b_im = B_im.data();
+    double *c_re = C_re.data(), *c_im = C_im.data();
+    gemm(&a_re, &a_im, &b_re, &b_im, &c_re, &c_im, &M, &K, &N);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; r++) {
+      gemm(&a_re, &a_im, &b_re, &b_im, &c_re, &c_im, &M, &K, &N);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count() / repetitions;
+    return 8.0 * M * K * N / seconds / 1e9;
+  }
+};
+
+static void bench_shape(size_t M, size_t K, size_t N) {
+  gemm_problem problem(M, K, N);
+  double flops = 8.0 * M * K * N;
+  // Aim for roughly a quarter of a second of baseline work
+  int repetitions = std::max(1, (int) (2.5e8 / flops));
+
+  double baseline = problem.run(baseline_gemm, repetitions);
+  std::vector<double> reference_re = problem.C_re, reference_im = problem.C_im;
+  double blocked = problem.run(DASH_GEMM_cpu, repetitions);
+
+  double max_error = 0;
+  for (size_t i = 0; i < M * N; i++) {
+    max_error = std::max(max_error, std::fabs(problem.C_re[i] - reference_re[i]));
+    max_error = std::max(max_error, std::fabs(problem.C_im[i] - reference_im[i]));
+  }
+  printf("%6zu %6zu %6zu %16.2f %16.2f %9.2fx %12.2e\n", M, K, N, baseline, blocked, blocked / baseline, max_error);
+}
+
+int main(int argc, char** argv) {
+  size_t max_square = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 1024;
+  const char* isa = getenv("DASH_GEMM_ISA");
+  const char* threads = getenv("DASH_GEMM_THREADS");
+
+  printf("DASH_GEMM_cpu benchmark (DASH_GEMM_ISA=%s, DASH_GEMM_THREADS=%s)\n", isa ? isa : "auto", threads ? threads : "1");
+  printf("%6s %6s %6s %16s %16s %10s %12s\n", "M", "K", "N", "naive (GFLOP/s)", "blocked (GFLOP/s)", "speedup", "max error");
+  for (size_t size = 64; size <= max_square; size *= 2) {
+    bench_shape(size, size, size);
+  }
+  // Skinny shapes: tall A, short inner dimension, and wide B
+  bench_shape(4096, 64, 64);
+  bench_shape(64, 4096, 64);
+  bench_shape(64, 64, 4096);
+  bench_shape(1000, 17, 333);
+  return 0;
+}
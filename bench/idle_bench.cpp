@@ -0,0 +1,104 @@
+/*
+ * Wake latency and idle CPU benchmark for the worker idle strategies.
+ *
+ * A consumer thread runs the same poll/idle loop as the runtime's workers while a producer publishes one timestamped
+ * item after each idle gap. The time from publication to the consumer dequeuing the item is the wake latency, and the
+ * consumer's thread CPU time over the run divided by the wall time is its CPU utilization while (mostly) idle.
+ *
+ * Usage: idle_bench [rounds per gap]
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <time.h>
+#include <vector>
+#include "idle_strategy.h"
+#include "mpmc_queue.h"
+
+static inline long long now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline long long thread_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct trial_result {
+  double p50_us;
+  double p99_us;
+  double cpu_percent;
+};
+
+trial_result run_trial(idle_strategy_t strategy, int rounds, int gap_us) {
+  mpmc_queue<long long> queue(64);
+  idle_parker parker;
+  std::atomic<bool> done(false);
+  std::vector<long long> latencies;
+  latencies.reserve(rounds);
+  long long consumer_cpu_ns = 0;
+
+  std::thread consumer([&]() {
+    int idle_iterations = 0;
+    long long cpu_start = thread_cpu_ns();
+    auto should_wake = [&]() { return !queue.empty_approx() || done.load(); };
+    while (true) {
+      long long published;
+      if (queue.try_pop(published)) {
+        latencies.push_back(now_ns() - published);
+        idle_iterations = 0;
+        continue;
+      }
+      if (done.load()) {
+        break;
+      }
+      idle_wait(strategy, parker, idle_iterations, should_wake);
+    }
+    consumer_cpu_ns = thread_cpu_ns() - cpu_start;
+  });
+
+  long long wall_start = now_ns();
+  for (int r = 0; r < rounds; r++) {
+    if (gap_us > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+    }
+    queue.push(now_ns());
+    parker.notify_one();
+  }
+  // Let the consumer drain before telling it to stop
+  while (!queue.empty_approx()) {
+    std::this_thread::yield();
+  }
+  done.store(true);
+  parker.notify_all();
+  consumer.join();
+  long long wall_ns = now_ns() - wall_start;
+
+  std::sort(latencies.begin(), latencies.end());
+  trial_result result;
+  result.p50_us = latencies[latencies.size() / 2] / 1000.0;
+  result.p99_us = latencies[(latencies.size() * 99) / 100] / 1000.0;
+  result.cpu_percent = 100.0 * consumer_cpu_ns / wall_ns;
+  return result;
+}
+
+int main(int argc, char** argv) {
+  int rounds = (argc > 1) ? atoi(argv[1]) : 500;
+  const int gaps_us[] = {0, 50, 1000, 10000};
+  const idle_strategy_t strategies[] = {IDLE_SPIN, IDLE_PARK};
+  const char* strategy_names[] = {"spin", "park"};
+
+  printf("Idle strategy benchmark: %d wake-ups per gap\n", rounds);
+  printf("%8s %10s %14s %14s %14s\n", "strategy", "gap (us)", "p50 wake (us)", "p99 wake (us)", "consumer CPU");
+  for (int s = 0; s < 2; s++) {
+    for (int gap : gaps_us) {
+      trial_result result = run_trial(strategies[s], rounds, gap);
+      printf("%8s %10d %14.2f %14.2f %13.1f%%\n", strategy_names[s], gap, result.p50_us, result.p99_us, result.cpu_percent);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Synthetic multi-application load for the runtime.
+ *
+ * Built as a shared object that mock_runtime launches like any other application. Every instance issues a stream of
+ * kernel calls drawn from a configurable mix, either back to back or with Poisson arrivals at a given rate, and records
+ * how long each call took from its arrival to its completion (so a call that arrives while the instance is still
+ * waiting on an earlier one is charged for the wait). When the runtime unloads the library, the combined throughput
+ * and latency percentiles of all instances are printed, per kernel and overall.
+ *
+ * Usage: mock_runtime [options] load_gen.so [instances] [key=value ...]
+ *   mix=<kernel>:<weight>,...  relative frequency of FFT, ZIP, GEMM and CONV_2D calls (default: FFT:1,ZIP:1,GEMM:1,CONV_2D:1)
+ *   requests=<n>               kernel calls per instance (default: 1000)
+ *   rate=<calls per second>    mean arrival rate per instance, 0 for back-to-back calls (default: 0)
+ *   fft=<points>               FFT size (default: 1024)
+ *   zip=<elements>             ZIP length, using ZIP_ADD (default: 4096)
+ *   gemm=<n>                   GEMM of two n x n complex matrices (default: 64)
+ *   conv=<n>                   CONV_2D image size, n x n (default: 128)
+ *   mask=<n>                   CONV_2D mask size (default: 5)
+ *   seed=<n>                   random seed, offset by the instance number (default: 1)
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "dash.h"
+
+enum load_kernel_t {
+  LOAD_FFT,
+  LOAD_ZIP,
+  LOAD_GEMM,
+  LOAD_CONV_2D,
+  LOAD_KERNEL_COUNT
+};
+
+static const char* load_kernel_names[LOAD_KERNEL_COUNT] = {"FFT", "ZIP", "GEMM", "CONV_2D"};
+
+struct load_config_t {
+  double weights[LOAD_KERNEL_COUNT] = {1, 1, 1, 1};
+  long requests = 1000;
+  double rate = 0;
+  size_t fft_size = 1024;
+  size_t zip_size = 4096;
+  size_t gemm_size = 64;
+  int conv_size = 128;
+  int mask_size = 5;
+  unsigned long seed = 1;
+};
+
+typedef std::chrono::steady_clock load_clock;
+
+// Latencies of every instance, reported when the library is unloaded
+class load_report {
+public:
+  ~load_report() {
+    if (instances == 0) {
+      return;
+    }
+    double seconds = std::chrono::duration<double>(last_end - first_start).count();
+    size_t calls = 0;
+    std::vector<double> all;
+    for (int k = 0; k < LOAD_KERNEL_COUNT; k++) {
+      calls += latencies_us[k].size();
+      all.insert(all.end(), latencies_us[k].begin(), latencies_us[k].end());
+    }
+    printf("[load_gen] %d instances completed %zu calls in %.3f s: %.0f calls/s\n", instances, calls, seconds,
+           calls / seconds);
+    printf("[load_gen] %-8s %8s %10s %10s %10s %10s\n", "kernel", "calls", "p50 us", "p90 us", "p99 us", "max us");
+    for (int k = 0; k < LOAD_KERNEL_COUNT; k++) {
+      print_row(load_kernel_names[k], latencies_us[k]);
+    }
+    print_row("all", all);
+  }
+
+  void add(const std::vector<double>* instance_latencies_us, load_clock::time_point start, load_clock::time_point end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int k = 0; k < LOAD_KERNEL_COUNT; k++) {
+      latencies_us[k].insert(latencies_us[k].end(), instance_latencies_us[k].begin(), instance_latencies_us[k].end());
+    }
+    first_start = (instances == 0) ? start : std::min(first_start, start);
+    last_end = (instances == 0) ? end : std::max(last_end, end);
+    instances++;
+  }
+
+private:
+  static void print_row(const char* name, std::vector<double>& samples) {
+    if (samples.empty()) {
+      return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double q) { return samples[(size_t) (q * (samples.size() - 1) + 0.5)]; };
+    printf("[load_gen] %-8s %8zu %10.1f %10.1f %10.1f %10.1f\n", name, samples.size(), at(0.5), at(0.9), at(0.99),
+           samples.back());
+  }
+
+  std::mutex mutex;
+  std::vector<double> latencies_us[LOAD_KERNEL_COUNT];
+  load_clock::time_point first_start, last_end;
+  int instances = 0;
+};
+
+static load_report report;
+static std::atomic<int> next_instance(0);
+
+static bool parse_mix(const char* text, load_config_t* config) {
+  for (int k = 0; k < LOAD_KERNEL_COUNT; k++) {
+    config->weights[k] = 0;
+  }
+  std::string mix(text);
+  size_t begin = 0;
+  while (begin < mix.size()) {
+    size_t end = mix.find(',', begin);
+    end = (end == std::string::npos) ? mix.size() : end;
+    std::string entry = mix.substr(begin, end - begin);
+    size_t colon = entry.find(':');
+    std::string name = entry.substr(0, colon);
+    double weight = (colon == std::string::npos) ? 1 : atof(entry.c_str() + colon + 1);
+    int k = 0;
+    while (k < LOAD_KERNEL_COUNT && name != load_kernel_names[k]) {
+      k++;
+    }
+    if (k == LOAD_KERNEL_COUNT || weight < 0) {
+      return false;
+    }
+    config->weights[k] = weight;
+    begin = end + 1;
+  }
+  return true;
+}
+
+static bool parse_args(int argc, char** argv, load_config_t* config) {
+  for (int i = 1; i < argc; i++) {
+    const char* value = strchr(argv[i], '=');
+    if (value == nullptr) {
+      return false;
+    }
+    std::string key(argv[i], value - argv[i]);
+    value++;
+    if (key == "mix") {
+      if (!parse_mix(value, config)) {
+        return false;
+      }
+    } else if (key == "requests") {
+      config->requests = atol(value);
+    } else if (key == "rate") {
+      config->rate = atof(value);
+    } else if (key == "fft") {
+      config->fft_size = strtoull(value, nullptr, 10);
+    } else if (key == "zip") {
+      config->zip_size = strtoull(value, nullptr, 10);
+    } else if (key == "gemm") {
+      config->gemm_size = strtoull(value, nullptr, 10);
+    } else if (key == "conv") {
+      config->conv_size = atoi(value);
+    } else if (key == "mask") {
+      config->mask_size = atoi(value);
+    } else if (key == "seed") {
+      config->seed = strtoul(value, nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  load_config_t config;
+  if (!parse_args(argc, argv, &config)) {
+    fprintf(stderr, "[load_gen] Usage: load_gen.so [mix=FFT:1,ZIP:1,GEMM:1,CONV_2D:1] [requests=n] [rate=calls/s] "
+                    "[fft=n] [zip=n] [gemm=n] [conv=n] [mask=n] [seed=n]\n");
+    return 1;
+  }
+  int instance = next_instance.fetch_add(1);
+
+  // Every instance works on its own buffers, reused by all its calls
+  std::vector<double> fft_in(2 * config.fft_size, 1.0), fft_out(2 * config.fft_size);
+  std::vector<double> zip_a(config.zip_size, 1.0), zip_b(config.zip_size, 2.0), zip_out(config.zip_size);
+  size_t gemm_elements = config.gemm_size * config.gemm_size;
+  std::vector<double> gemm_a(gemm_elements, 1.0), gemm_b(gemm_elements, 0.5), gemm_re(gemm_elements), gemm_im(gemm_elements);
+  size_t conv_elements = (size_t) config.conv_size * config.conv_size;
+  std::vector<double> conv_in(conv_elements, 1.0), conv_out(conv_elements);
+  std::vector<double> conv_mask((size_t) config.mask_size * config.mask_size, 1.0 / (config.mask_size * config.mask_size));
+
+  std::mt19937_64 rng(config.seed + instance);
+  std::discrete_distribution<int> pick_kernel(config.weights, config.weights + LOAD_KERNEL_COUNT);
+  std::exponential_distribution<double> interarrival_s(config.rate > 0 ? config.rate : 1.0);
+  std::vector<double> latencies_us[LOAD_KERNEL_COUNT];
+
+  load_clock::time_point start = load_clock::now();
+  load_clock::time_point arrival = start;
+  for (long r = 0; r < config.requests; r++) {
+    int kernel = pick_kernel(rng);
+    if (config.rate > 0) {
+      arrival += std::chrono::duration_cast<load_clock::duration>(std::chrono::duration<double>(interarrival_s(rng)));
+      std::this_thread::sleep_until(arrival);
+    } else {
+      arrival = load_clock::now();
+    }
+    switch (kernel) {
+      case LOAD_FFT:
+        DASH_FFT(fft_in.data(), fft_out.data(), config.fft_size, true);
+        break;
+      case LOAD_ZIP:
+        DASH_ZIP(zip_a.data(), zip_b.data(), zip_out.data(), config.zip_size, ZIP_ADD);
+        break;
+      case LOAD_GEMM:
+        DASH_GEMM(gemm_a.data(), gemm_b.data(), gemm_b.data(), gemm_a.data(), gemm_re.data(), gemm_im.data(),
+                  config.gemm_size, config.gemm_size, config.gemm_size);
+        break;
+      default:
+        DASH_CONV_2D(conv_in.data(), config.conv_size, config.conv_size, conv_mask.data(), config.mask_size, conv_out.data());
+    }
+    latencies_us[kernel].push_back(std::chrono::duration<double, std::micro>(load_clock::now() - arrival).count());
+  }
+  report.add(latencies_us, start, load_clock::now());
+  return 0;
+}
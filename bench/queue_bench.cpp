@@ -0,0 +1,104 @@
+/*
+ * Contention benchmark for the runtime's ready queue.
+ *
+ * Compares the lock-free mpmc_queue used by enqueue_kernel against the mutex-protected std::deque it replaced.
+ * Every producer thread pushes a fixed number of items while a set of consumer threads (standing in for the
+ * runtime's worker pool) drain them, and the combined enqueue+dequeue rate is reported.
+ *
+ * Usage: queue_bench [items per producer] [consumer threads]
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+#include "mpmc_queue.h"
+
+class mutex_deque {
+public:
+  mutex_deque() { pthread_mutex_init(&mutex, nullptr); }
+  ~mutex_deque() { pthread_mutex_destroy(&mutex); }
+
+  void push(void* value) {
+    pthread_mutex_lock(&mutex);
+    list.push_back(value);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  bool try_pop(void*& value) {
+    pthread_mutex_lock(&mutex);
+    if (list.empty()) {
+      pthread_mutex_unlock(&mutex);
+      return false;
+    }
+    value = list.front();
+    list.pop_front();
+    pthread_mutex_unlock(&mutex);
+    return true;
+  }
+
+private:
+  std::deque<void*> list;
+  pthread_mutex_t mutex;
+};
+
+template <typename Queue>
+double run_trial(Queue& queue, int producers, int consumers, size_t items_per_producer) {
+  const size_t total = (size_t) producers * items_per_producer;
+  std::atomic<size_t> consumed(0);
+  std::atomic<bool> start(false);
+  std::vector<std::thread> threads;
+
+  for (int c = 0; c < consumers; c++) {
+    threads.emplace_back([&]() {
+      while (!start.load(std::memory_order_acquire)) {}
+      void* value;
+      while (consumed.load(std::memory_order_relaxed) < total) {
+        if (queue.try_pop(value)) {
+          consumed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+          sched_yield();
+        }
+      }
+    });
+  }
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&, p]() {
+      while (!start.load(std::memory_order_acquire)) {}
+      for (size_t i = 0; i < items_per_producer; i++) {
+        queue.push((void*) (uintptr_t) (p * items_per_producer + i + 1));
+      }
+    });
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(t1 - t0).count();
+  return total / seconds;
+}
+
+int main(int argc, char** argv) {
+  size_t items_per_producer = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 100000;
+  int consumers = (argc > 2) ? atoi(argv[2]) : 4;
+  const int producer_counts[] = {1, 2, 4, 8, 16, 32, 64};
+
+  printf("Ready queue contention benchmark: %zu items per producer, %d consumers, %u hardware threads\n",
+         items_per_producer, consumers, std::thread::hardware_concurrency());
+  printf("%10s %20s %20s %10s\n", "producers", "mutex deque (op/s)", "mpmc queue (op/s)", "speedup");
+  for (int producers : producer_counts) {
+    mutex_deque locked;
+    mpmc_queue<void*> lockfree(4096);
+    double locked_rate = run_trial(locked, producers, consumers, items_per_producer);
+    double lockfree_rate = run_trial(lockfree, producers, consumers, items_per_producer);
+    printf("%10d %20.0f %20.0f %9.2fx\n", producers, locked_rate, lockfree_rate, lockfree_rate / locked_rate);
+  }
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Empty-kernel round-trip latency benchmark for the kernel completion handshake.
+ *
+ * An application thread enqueues an empty kernel and waits for it while a worker thread pops it, runs it and hands it
+ * back, mirroring the path through enqueue_kernel and the runtime's worker loop. The handshake is done either with the
+ * per-call pthread_barrier_t the DASH wrappers used to create, or with dash_completion_t.
+ *
+ * Usage: roundtrip_bench [round trips] [application threads]
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+#include "dash_completion.h"
+#include "idle_strategy.h"
+#include "mpmc_queue.h"
+
+enum handshake_t {
+  HANDSHAKE_BARRIER,
+  HANDSHAKE_COMPLETION
+};
+
+struct bench_task {
+  void (*run_function)(void);
+  pthread_barrier_t* barrier;
+  dash_completion_t* completion;
+};
+
+static void empty_kernel(void) {
+  asm volatile("" ::: "memory");
+}
+
+static inline long long now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<long long> run_trial(handshake_t handshake, int round_trips, int app_threads) {
+  mpmc_queue<bench_task*> queue(1024);
+  idle_parker parker;
+  std::atomic<bool> done(false);
+  std::vector<std::vector<long long>> latencies(app_threads);
+
+  std::thread worker([&]() {
+    int idle_iterations = 0;
+    auto should_wake = [&]() { return !queue.empty_approx() || done.load(); };
+    while (true) {
+      bench_task* task;
+      if (queue.try_pop(task)) {
+        idle_iterations = 0;
+        task->run_function();
+        if (handshake == HANDSHAKE_BARRIER) {
+          pthread_barrier_wait(task->barrier);
+        } else {
+          dash_completion_signal(task->completion);
+        }
+        continue;
+      }
+      if (done.load()) {
+        break;
+      }
+      idle_wait(IDLE_PARK, parker, idle_iterations, should_wake);
+    }
+  });
+
+  std::vector<std::thread> apps;
+  for (int a = 0; a < app_threads; a++) {
+    apps.emplace_back([&, a]() {
+      latencies[a].reserve(round_trips);
+      for (int r = 0; r < round_trips; r++) {
+        bench_task task;
+        task.run_function = empty_kernel;
+        long long start = now_ns();
+        if (handshake == HANDSHAKE_BARRIER) {
+          pthread_barrier_t barrier;
+          pthread_barrier_init(&barrier, nullptr, 2);
+          task.barrier = &barrier;
+          queue.push(&task);
+          parker.notify_one();
+          pthread_barrier_wait(&barrier);
+          pthread_barrier_destroy(&barrier);
+        } else {
+          dash_completion_t completion;
+          dash_completion_init(&completion);
+          task.completion = &completion;
+          queue.push(&task);
+          parker.notify_one();
+          dash_completion_wait(&completion);
+        }
+        latencies[a].push_back(now_ns() - start);
+      }
+    });
+  }
+  for (auto& app : apps) {
+    app.join();
+  }
+  done.store(true);
+  parker.notify_all();
+  worker.join();
+
+  std::vector<long long> all;
+  for (auto& l : latencies) {
+    all.insert(all.end(), l.begin(), l.end());
+  }
+  std::sort(all.begin(), all.end());
+  return all;
+}
+
+int main(int argc, char** argv) {
+  int round_trips = (argc > 1) ? atoi(argv[1]) : 100000;
+  int max_app_threads = (argc > 2) ? atoi(argv[2]) : 4;
+  const char* names[] = {"pthread_barrier_t", "dash_completion_t"};
+
+  printf("Empty-kernel round-trip benchmark: %d round trips per application thread, 1 worker\n", round_trips);
+  printf("%18s %8s %12s %12s %12s\n", "handshake", "apps", "mean (ns)", "p50 (ns)", "p99 (ns)");
+  for (int apps = 1; apps <= max_app_threads; apps *= 2) {
+    for (int h = HANDSHAKE_BARRIER; h <= HANDSHAKE_COMPLETION; h++) {
+      std::vector<long long> latencies = run_trial((handshake_t) h, round_trips, apps);
+      double mean = 0;
+      for (long long l : latencies) {
+        mean += l;
+      }
+      mean /= latencies.size();
+      printf("%18s %8d %12.0f %12lld %12lld\n", names[h], apps, mean, latencies[latencies.size() / 2],
+             latencies[(latencies.size() * 99) / 100]);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Per-event cost of the runtime's task tracing.
+ *
+ * Each thread records events into a trace_recorder as fast as it can, cycling through the same event types as a task
+ * does in the runtime. Reports the average time per recorded event, next to the cost of the timestamp read alone and
+ * of a locked printf to /dev/null (what the LOG macro does per dispatch step), for 1 to 8 recording threads.
+ *
+ * Usage: trace_bench [events per thread]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "trace.h"
+
+static double ns_per_event(int threads, long events, void (*body)(int, long)) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; t++) {
+    pool.emplace_back(body, t, events);
+  }
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+  // Threads run concurrently, so wall time per thread's event is what each recording thread pays
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / events;
+}
+
+static trace_recorder* recorder = nullptr;
+static FILE* null_file = nullptr;
+static volatile uint64_t sink;
+
+static void record_events(int thread, long events) {
+  uint64_t id = recorder->next_task_id();
+  for (long i = 0; i < events; i++) {
+    recorder->record((trace_event_type_t) (i & 3), id + (i >> 2), (int) (i & 7), thread, thread);
+  }
+}
+
+static void read_timestamp(int, long events) {
+  uint64_t total = 0;
+  for (long i = 0; i < events; i++) {
+    total += trace_ticks();
+  }
+  sink = total;
+}
+
+static void print_events(int thread, long events) {
+  for (long i = 0; i < events; i++) {
+    fprintf(null_file, "[cedr] Worker %d is processing a node named %s\n", thread, "FFT");
+  }
+}
+
+int main(int argc, char** argv) {
+  long events = (argc > 1) ? atol(argv[1]) : 10000000;
+  null_file = fopen("/dev/null", "w");
+
+  printf("Tracing cost per event, ns (%ld events per thread)\n", events);
+  printf("%8s %12s %12s %12s\n", "threads", "trace event", "timestamp", "printf");
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    recorder = new trace_recorder();
+    double trace = ns_per_event(threads, events, record_events);
+    delete recorder;
+    double timestamp = ns_per_event(threads, events, read_timestamp);
+    double print = ns_per_event(threads, events / 10, print_events);
+    printf("%8d %12.1f %12.1f %12.1f\n", threads, trace, timestamp, print);
+  }
+  fclose(null_file);
+  return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * DASH_ZIP_cpu streaming benchmark.
+ *
+ * For every op and a range of working-set sizes (from L1-resident to DRAM-bound), reports the effective bandwidth in
+ * GB/s (bytes read plus bytes written per call) of the op-specialized DASH_ZIP_cpu, of the original implementation
+ * with the switch inside the loop (for the ops it supports), and of memcpy over the same number of bytes as a
+ * reference for the attainable memory bandwidth. Outputs are checked against the original implementation.
+ * Set DASH_ZIP_ISA to compare instruction sets.
+ *
+ * Usage: zip_bench [max elements]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "dash.h"
+
+extern "C" void DASH_ZIP_cpu(double** input_1, double** input_2, double** output, size_t* size, zip_op_t* op);
+
+// DASH_ZIP_cpu as it was before the op was hoisted out of the loop
+static void baseline_zip(double** input_1, double** input_2, double** output, size_t* size, zip_op_t* op) {
+  for (size_t i = 0; i < *size; i++) {
+    switch (*op) {
+      case ZIP_ADD:
+        (*output)[i] = (*input_1)[i] + (*input_2)[i];
+        break;
+      case ZIP_SUB:
+        (*output)[i] = (*input_1)[i] - (*input_2)[i];
+        break;
+      case ZIP_MULT:
+        (*output)[i] = (*input_1)[i] * (*input_2)[i];
+        break;
+      case ZIP_DIV:
+        (*output)[i] = (*input_1)[i] / (*input_2)[i];
+        break;
+      case ZIP_CMP_MULT:
+        (*output)[i*2] = (*input_1)[i*2] * (*input_2)[i*2] - (*input_1)[i*2+1] * (*input_2)[i*2+1];
+        (*output)[i*2+1] = (*input_1)[i*2+1] * (*input_2)[i*2] + (*input_1)[i*2] * (*input_2)[i*2+1];
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Reference results for the ops the original implementation didn't have
+static void reference_zip(const double* in1, const double* in2, double* out, size_t n, zip_op_t op) {
+  for (size_t i = 0; i < n; i++) {
+    switch (op) {
+      case ZIP_FMA:
+        out[i] = in1[i] * in2[i] + out[i];
+        break;
+      case ZIP_SCALE:
+        out[i] = in1[i] * in2[0];
+        break;
+      case ZIP_CMP_CONJ_MULT:
+        out[2 * i] = in1[2 * i] * in2[2 * i] + in1[2 * i + 1] * in2[2 * i + 1];
+        out[2 * i + 1] = in1[2 * i + 1] * in2[2 * i] - in1[2 * i] * in2[2 * i + 1];
+        break;
+      case ZIP_CMP_MAG:
+        out[i] = std::sqrt(in1[2 * i] * in1[2 * i] + in1[2 * i + 1] * in1[2 * i + 1]);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+struct op_info {
+  zip_op_t op;
+  const char* name;
+  bool complex;
+  size_t bytes_per_element;  // bytes read + written per (real or complex) element
+  bool in_baseline;
+};
+
+static const op_info ops[] = {
+  {ZIP_ADD, "ADD", false, 24, true},
+  {ZIP_SUB, "SUB", false, 24, true},
+  {ZIP_MULT, "MULT", false, 24, true},
+  {ZIP_DIV, "DIV", false, 24, true},
+  {ZIP_FMA, "FMA", false, 32, false},
+  {ZIP_SCALE, "SCALE", false, 16, false},
+  {ZIP_CMP_MULT, "CMP_MULT", true, 48, true},
+  {ZIP_CMP_CONJ_MULT, "CMP_CONJ_MULT", true, 48, false},
+  {ZIP_CMP_MAG, "CMP_MAG", true, 24, false},
+};
+
+typedef void (*zip_function)(double**, double**, double**, size_t*, zip_op_t*);
+
+static double seconds_per_call(zip_function zip, double* in1, double* in2, double* out, size_t n, zip_op_t op, int calls) {
+  zip(&in1, &in2, &out, &n, &op);
+  auto start = std::chrono::steady_clock::now();
+  for (int c = 0; c < calls; c++) {
+    zip(&in1, &in2, &out, &n, &op);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count() / calls;
+}
+
+int main(int argc, char** argv) {
+  size_t max_elements = (argc > 1) ? strtoul(argv[1], nullptr, 10) : (1 << 24);
+  const char* isa = getenv("DASH_ZIP_ISA");
+  printf("DASH_ZIP_cpu benchmark (DASH_ZIP_ISA=%s), effective GB/s\n", isa ? isa : "auto");
+  printf("%14s %10s %12s %12s %12s %12s\n", "op", "elements", "baseline", "specialized", "memcpy", "max error");
+
+  for (size_t n = 1 << 10; n <= max_elements; n <<= 4) {
+    // Complex ops read 2 * n doubles per input
+    std::vector<double> in1(2 * n), in2(2 * n), out(2 * n), expected(2 * n), copy_dst(8 * n);
+    for (size_t i = 0; i < 2 * n; i++) {
+      in1[i] = 1.0 + sin(0.01 * i);
+      in2[i] = 2.0 + cos(0.03 * i);
+    }
+    int calls = std::max(3, (int) (1e9 / (48.0 * n)));
+
+    for (const op_info& info : ops) {
+      double bytes = (double) info.bytes_per_element * n;
+
+      // Check against the original implementation or the reference loop (FMA accumulates, so start from zero)
+      std::fill(out.begin(), out.end(), 0.0);
+      std::fill(expected.begin(), expected.end(), 0.0);
+      double *a = in1.data(), *b = in2.data(), *o = out.data();
+      zip_op_t op = info.op;
+      DASH_ZIP_cpu(&a, &b, &o, &n, &op);
+      if (info.in_baseline) {
+        double* e = expected.data();
+        baseline_zip(&a, &b, &e, &n, &op);
+      } else {
+        reference_zip(a, b, expected.data(), n, op);
+      }
+      double max_error = 0;
+      for (size_t i = 0; i < 2 * n; i++) {
+        max_error = std::max(max_error, std::fabs(out[i] - expected[i]));
+      }
+
+      double specialized = bytes / seconds_per_call(DASH_ZIP_cpu, in1.data(), in2.data(), out.data(), n, info.op, calls) / 1e9;
+      char baseline[32] = "-";
+      if (info.in_baseline) {
+        double rate = bytes / seconds_per_call(baseline_zip, in1.data(), in2.data(), out.data(), n, info.op, calls) / 1e9;
+        snprintf(baseline, sizeof(baseline), "%.2f", rate);
+      }
+
+      size_t copy_bytes = std::min((size_t) bytes / 2, copy_dst.size() * sizeof(double) / 2);
+      char* copy_src = (char*) copy_dst.data();
+      auto start = std::chrono::steady_clock::now();
+      for (int c = 0; c < calls; c++) {
+        memcpy(copy_src + copy_bytes, copy_src, copy_bytes);
+        asm volatile("" ::: "memory");
+      }
+      auto end = std::chrono::steady_clock::now();
+      double memcpy_rate = 2.0 * copy_bytes * calls / std::chrono::duration<double>(end - start).count() / 1e9;
+
+      printf("%14s %10zu %12s %12.2f %12.2f %12.2e\n", info.name, n, baseline, specialized, memcpy_rate, max_error);
+    }
+  }
+  return 0;
+}
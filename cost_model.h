@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <pthread.h>
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+// Weight the history keeps each time a new measurement is added, so the model follows changes in the machine's load
+#define COST_MODEL_DECAY 0.98
+// Estimate for a kernel type that hasn't been measured yet
+#define COST_MODEL_PRIOR_NS_PER_UNIT 1.0
+
+/*
+ * Online estimate of kernel execution times. For every kernel type the execution time is modelled as
+ *   time = fixed_ns + per_unit_ns * work
+ * where work is the kernel's own estimate of a call's size (see dash_kernel_descriptor_t::work). The two
+ * coefficients are a least-squares fit over all measurements so far, weighted so that older ones decay away.
+ *
+ * Estimates are lock-free. Measurements are folded in under a per-kernel mutex, and a worker that finds the mutex
+ * taken drops its measurement rather than wait, so recording never stalls the dispatch path.
+ */
+class cost_model {
+public:
+  explicit cost_model(size_t kinds) : num_kinds(kinds), entries(new entry[kinds]) {}
+
+  ~cost_model() { delete[] entries; }
+
+  cost_model(const cost_model&) = delete;
+  cost_model& operator=(const cost_model&) = delete;
+
+  double estimate_ns(size_t kind, double work) const {
+    const entry& e = entries[kind];
+    return e.fixed_ns.load(std::memory_order_relaxed) + e.per_unit_ns.load(std::memory_order_relaxed) * work;
+  }
+
+  void record(size_t kind, double work, double ns) {
+    entry& e = entries[kind];
+    if (pthread_mutex_trylock(&e.mutex) != 0) {
+      return;
+    }
+    e.n = e.n * COST_MODEL_DECAY + 1;
+    e.sw = e.sw * COST_MODEL_DECAY + work;
+    e.st = e.st * COST_MODEL_DECAY + ns;
+    e.sww = e.sww * COST_MODEL_DECAY + work * work;
+    e.swt = e.swt * COST_MODEL_DECAY + work * ns;
+    e.samples++;
+
+    double fixed = 0, per_unit = 0;
+    double denominator = e.n * e.sww - e.sw * e.sw;
+    if (denominator > 1e-9 * e.n * e.sww) {
+      per_unit = (e.n * e.swt - e.sw * e.st) / denominator;
+      fixed = (e.st - per_unit * e.sw) / e.n;
+    }
+    // With too little spread in the measured sizes (or a fit that makes no physical sense), fall back to pure
+    // proportionality, or a constant if the kernel reports no work at all
+    if (denominator <= 1e-9 * e.n * e.sww || per_unit < 0 || fixed < 0) {
+      per_unit = (e.sw > 0) ? e.st / e.sw : 0;
+      fixed = (e.sw > 0) ? 0 : e.st / e.n;
+    }
+    e.fixed_ns.store(fixed, std::memory_order_relaxed);
+    e.per_unit_ns.store(per_unit, std::memory_order_relaxed);
+    pthread_mutex_unlock(&e.mutex);
+  }
+
+  size_t kinds() const { return num_kinds; }
+  size_t samples(size_t kind) const { return entries[kind].samples; }
+  double fixed_ns(size_t kind) const { return entries[kind].fixed_ns.load(std::memory_order_relaxed); }
+  double per_unit_ns(size_t kind) const { return entries[kind].per_unit_ns.load(std::memory_order_relaxed); }
+
+private:
+  struct alignas(CACHE_LINE_SIZE) entry {
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    // Decayed count and sums of work, time, work^2 and work * time over the measurements
+    double n = 0, sw = 0, st = 0, sww = 0, swt = 0;
+    size_t samples = 0;
+    std::atomic<double> fixed_ns{0};
+    std::atomic<double> per_unit_ns{COST_MODEL_PRIOR_NS_PER_UNIT};
+  };
+
+  size_t num_kinds;
+  entry* entries;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * Which runtime threads are pinned to a CPU:
+ * - PIN_NONE: leave placement to the OS scheduler
+ * - PIN_WORKERS: worker w runs on the w-th CPU of the allowed set (wrapping around)
+ * - PIN_ALL: additionally, every application thread runs on the CPU of its home worker
+ */
+enum pin_mode_t {
+  PIN_NONE,
+  PIN_WORKERS,
+  PIN_ALL
+};
+
+static inline bool parse_pin_mode(const char* name, pin_mode_t* mode) {
+  if (strcmp(name, "none") == 0) {
+    *mode = PIN_NONE;
+  } else if (strcmp(name, "workers") == 0) {
+    *mode = PIN_WORKERS;
+  } else if (strcmp(name, "all") == 0) {
+    *mode = PIN_ALL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// The CPUs threads may be pinned to, in the order they are handed out
+struct cpu_list_t {
+  int cpus[CPU_SETSIZE];
+  int count;
+};
+
+// Parses a list such as "0-3,8,10-11". Returns false on a malformed list or one that names no CPU.
+static inline bool parse_cpu_list(const char* text, cpu_list_t* list) {
+  list->count = 0;
+  const char* p = text;
+  while (*p != '\0') {
+    char* end;
+    long first = strtol(p, &end, 10);
+    if (end == p || first < 0 || first >= CPU_SETSIZE) {
+      return false;
+    }
+    long last = first;
+    p = end;
+    if (*p == '-') {
+      last = strtol(p + 1, &end, 10);
+      if (end == p + 1 || last < first || last >= CPU_SETSIZE) {
+        return false;
+      }
+      p = end;
+    }
+    for (long cpu = first; cpu <= last && list->count < CPU_SETSIZE; cpu++) {
+      list->cpus[list->count++] = (int) cpu;
+    }
+    if (*p == ',') {
+      p++;
+    } else if (*p != '\0') {
+      return false;
+    }
+  }
+  return list->count > 0;
+}
+
+// The CPUs this process is currently allowed to run on
+static inline void allowed_cpu_list(cpu_list_t* list) {
+  cpu_set_t set;
+  list->count = 0;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        list->cpus[list->count++] = cpu;
+      }
+    }
+  }
+  if (list->count == 0) {
+    list->cpus[list->count++] = 0;
+  }
+}
+
+// Pins the calling thread to the index-th CPU of the list (wrapping around)
+static inline void pin_current_thread(const cpu_list_t* list, int index) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  int cpu = list->cpus[index % list->count];
+  CPU_SET(cpu, &set);
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (err != 0) {
+    fprintf(stderr, "[cedr] Unable to pin a thread to CPU %d: %s\n", cpu, strerror(err));
+  }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * How worker threads behave when the ready queue is empty:
+ * - IDLE_SPIN: keep polling the queue and yield the core between polls (lowest wake latency, burns a core per worker)
+ * - IDLE_PARK: briefly spin, then yield, then block on a condition variable until a producer wakes it
+ */
+enum idle_strategy_t {
+  IDLE_SPIN,
+  IDLE_PARK
+};
+
+// Number of pause iterations and then sched_yield calls a parking worker performs before it blocks
+#define IDLE_SPIN_ITERATIONS 4096
+#define IDLE_YIELD_ITERATIONS 64
+
+static inline bool parse_idle_strategy(const char* name, idle_strategy_t* strategy) {
+  if (strcmp(name, "spin") == 0) {
+    *strategy = IDLE_SPIN;
+  } else if (strcmp(name, "park") == 0) {
+    *strategy = IDLE_PARK;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+/*
+ * Lets idle consumers sleep until a producer publishes new work.
+ * Producers only pay for an atomic load when nobody is parked, which keeps enqueue_kernel cheap on the hot path.
+ */
+class idle_parker {
+public:
+  idle_parker() : sleepers(0) {
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&cond, nullptr);
+  }
+
+  ~idle_parker() {
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  idle_parker(const idle_parker&) = delete;
+  idle_parker& operator=(const idle_parker&) = delete;
+
+  // Blocks the calling thread until should_wake() returns true. should_wake is re-checked after registering as a
+  // sleeper so that a producer which published work just before we registered is never missed.
+  template <typename Predicate>
+  void park(Predicate should_wake) {
+    pthread_mutex_lock(&mutex);
+    sleepers.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (!should_wake()) {
+      pthread_cond_wait(&cond, &mutex);
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  // Must be called after the work that should_wake() observes has been published. Returns whether anyone was parked.
+  bool notify_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) {
+      pthread_mutex_lock(&mutex);
+      pthread_cond_signal(&cond);
+      pthread_mutex_unlock(&mutex);
+      return true;
+    }
+    return false;
+  }
+
+  void notify_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0) {
+      pthread_mutex_lock(&mutex);
+      pthread_cond_broadcast(&cond);
+      pthread_mutex_unlock(&mutex);
+    }
+  }
+
+private:
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  std::atomic<int> sleepers;
+};
+
+/*
+ * Called by a consumer each time it finds no work. idle_iterations counts consecutive empty polls and is reset to
+ * zero by the caller whenever it finds work (and here, after waking from a park).
+ */
+template <typename Predicate>
+static inline void idle_wait(idle_strategy_t strategy, idle_parker& parker, int& idle_iterations, Predicate should_wake) {
+  if (strategy == IDLE_SPIN) {
+    sched_yield();
+    return;
+  }
+  if (idle_iterations < IDLE_SPIN_ITERATIONS) {
+    cpu_relax();
+    idle_iterations++;
+  } else if (idle_iterations < IDLE_SPIN_ITERATIONS + IDLE_YIELD_ITERATIONS) {
+    sched_yield();
+    idle_iterations++;
+  } else {
+    parker.park(should_wake);
+    idle_iterations = 0;
+  }
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "dash.h"
+#include "dash_kernels.h"
+
+/*
+ * Recording of the kernel calls that reach the runtime, for replaying them later against another scheduler or worker
+ * configuration. A recorded call keeps its kernel, the application instance that made it and that instance's priority,
+ * when it arrived (relative to the start of the recording) and one 64-bit value per argument: the value of every scalar
+ * argument, and the extent of every buffer argument in doubles. Buffer contents are not recorded; a replay runs every
+ * call on synthetic buffers of the recorded sizes.
+ *
+ * Every recording thread appends to its own list, so recording takes no lock. The lists are merged in arrival order
+ * when the stream is written, once every recording thread has been joined.
+ *
+ * File layout, all integers little-endian:
+ *   "DASHKRN1"
+ *   uint32 kernel count, then per kernel: uint32 argument count, uint32 name length, name
+ *   uint64 call count, then per call: uint64 arrival ns, int32 app instance, uint32 priority, uint32 kernel index,
+ *     uint64 value per argument
+ * Kernels are matched to the replaying runtime's registry by name.
+ */
+#define KERNEL_STREAM_MAGIC "DASHKRN1"
+#define KERNEL_STREAM_MAX_ARGS 15
+
+struct recorded_call_t {
+  uint64_t arrival_ns;
+  int32_t app_instance;
+  uint32_t priority;
+  uint32_t kernel_id;
+  uint64_t values[KERNEL_STREAM_MAX_ARGS];
+};
+
+// Storage for the arguments of a replayed call, pointed to by the args handed to the runtime
+union replay_arg_value_t {
+  double* f64_buffer;
+  size_t size;
+  int integer;
+  bool boolean;
+  zip_op_t zip_op;
+};
+
+// Encodes the arguments of a call of a registered kernel
+static inline void encode_kernel_args(const dash_kernel_descriptor_t* kernel, void* const* args, uint64_t* values) {
+  dash_buffer_extent_t extents[KERNEL_STREAM_MAX_ARGS];
+  kernel->buffers(args, extents);
+  for (size_t i = 0; i < kernel->num_args; i++) {
+    switch (kernel->arg_kinds[i]) {
+      case DASH_ARG_F64_BUFFER: values[i] = extents[i].length; break;
+      case DASH_ARG_SIZE: values[i] = *(size_t*) args[i]; break;
+      case DASH_ARG_INT: values[i] = (uint64_t) (int64_t) *(int*) args[i]; break;
+      case DASH_ARG_BOOL: values[i] = *(bool*) args[i] ? 1 : 0; break;
+      case DASH_ARG_ZIP_OP: values[i] = (uint64_t) *(zip_op_t*) args[i]; break;
+    }
+  }
+}
+
+/*
+ * Decodes the arguments of a recorded call into storage, pointing args at them. Buffer arguments point to buffers,
+ * which must hold at least as many doubles as the call's recorded extent for that argument.
+ */
+static inline void decode_kernel_args(const dash_kernel_descriptor_t* kernel, const uint64_t* values, double* const* buffers,
+                                      replay_arg_value_t* storage, void** args) {
+  for (size_t i = 0; i < kernel->num_args; i++) {
+    switch (kernel->arg_kinds[i]) {
+      case DASH_ARG_F64_BUFFER: storage[i].f64_buffer = buffers[i]; break;
+      case DASH_ARG_SIZE: storage[i].size = (size_t) values[i]; break;
+      case DASH_ARG_INT: storage[i].integer = (int) (int64_t) values[i]; break;
+      case DASH_ARG_BOOL: storage[i].boolean = values[i] != 0; break;
+      case DASH_ARG_ZIP_OP: storage[i].zip_op = (zip_op_t) values[i]; break;
+    }
+    args[i] = &storage[i];
+  }
+}
+
+class kernel_stream_recorder {
+public:
+  explicit kernel_stream_recorder(uint64_t origin) : origin_ns(origin), lists(nullptr) {
+    pthread_mutex_init(&lists_mutex, nullptr);
+  }
+
+  ~kernel_stream_recorder() {
+    while (lists != nullptr) {
+      call_list* next = lists->next;
+      delete lists;
+      lists = next;
+    }
+    pthread_mutex_destroy(&lists_mutex);
+  }
+
+  kernel_stream_recorder(const kernel_stream_recorder&) = delete;
+  kernel_stream_recorder& operator=(const kernel_stream_recorder&) = delete;
+
+  void record(int kernel_id, void* const* args, int app_instance, unsigned priority, uint64_t now_ns) {
+    call_list* list = local_list();
+    list->calls.emplace_back();
+    recorded_call_t& call = list->calls.back();
+    call.arrival_ns = now_ns - origin_ns;
+    call.app_instance = app_instance;
+    call.priority = priority;
+    call.kernel_id = (uint32_t) kernel_id;
+    encode_kernel_args(&dash_kernel_registry[kernel_id], args, call.values);
+  }
+
+  // Writes every call recorded so far in arrival order; only valid once the recording threads have been joined
+  size_t write(const char* path) const {
+    std::vector<recorded_call_t> calls;
+    for (call_list* list = lists; list != nullptr; list = list->next) {
+      calls.insert(calls.end(), list->calls.begin(), list->calls.end());
+    }
+    std::stable_sort(calls.begin(), calls.end(),
+                     [](const recorded_call_t& a, const recorded_call_t& b) { return a.arrival_ns < b.arrival_ns; });
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+      return (size_t) -1;
+    }
+    fwrite(KERNEL_STREAM_MAGIC, 1, strlen(KERNEL_STREAM_MAGIC), file);
+    uint32_t kernel_count = DASH_KERNEL_COUNT;
+    fwrite(&kernel_count, sizeof(kernel_count), 1, file);
+    for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+      uint32_t num_args = (uint32_t) dash_kernel_registry[k].num_args;
+      uint32_t name_length = (uint32_t) strlen(dash_kernel_registry[k].name);
+      fwrite(&num_args, sizeof(num_args), 1, file);
+      fwrite(&name_length, sizeof(name_length), 1, file);
+      fwrite(dash_kernel_registry[k].name, 1, name_length, file);
+    }
+    uint64_t call_count = calls.size();
+    fwrite(&call_count, sizeof(call_count), 1, file);
+    for (const recorded_call_t& call : calls) {
+      fwrite(&call.arrival_ns, sizeof(call.arrival_ns), 1, file);
+      fwrite(&call.app_instance, sizeof(call.app_instance), 1, file);
+      fwrite(&call.priority, sizeof(call.priority), 1, file);
+      fwrite(&call.kernel_id, sizeof(call.kernel_id), 1, file);
+      fwrite(call.values, sizeof(uint64_t), dash_kernel_registry[call.kernel_id].num_args, file);
+    }
+    return (fclose(file) == 0) ? calls.size() : (size_t) -1;
+  }
+
+private:
+  struct call_list {
+    std::vector<recorded_call_t> calls;
+    call_list* next;
+  };
+
+  call_list* local_list() {
+    // One list per thread; a thread that switches to another recorder starts a new list there
+    static thread_local const kernel_stream_recorder* owner = nullptr;
+    static thread_local call_list* local = nullptr;
+    if (owner != this) {
+      local = new call_list();
+      pthread_mutex_lock(&lists_mutex);
+      local->next = lists;
+      lists = local;
+      pthread_mutex_unlock(&lists_mutex);
+      owner = this;
+    }
+    return local;
+  }
+
+  const uint64_t origin_ns;
+  pthread_mutex_t lists_mutex;
+  call_list* lists;
+};
+
+// Reads a recorded stream, mapping its kernels to this build's registry by name; reports what is wrong on error
+static inline bool load_kernel_stream(const char* path, std::vector<recorded_call_t>& calls) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "[cedr] Unable to open kernel stream %s\n", path);
+    return false;
+  }
+  bool ok = true;
+  char magic[8];
+  uint32_t kernel_count = 0;
+  ok = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, KERNEL_STREAM_MAGIC, sizeof(magic)) == 0 &&
+       fread(&kernel_count, sizeof(kernel_count), 1, file) == 1;
+  std::vector<int> kernel_ids;
+  for (uint32_t k = 0; ok && k < kernel_count; k++) {
+    uint32_t num_args, name_length;
+    ok = fread(&num_args, sizeof(num_args), 1, file) == 1 && fread(&name_length, sizeof(name_length), 1, file) == 1 &&
+         name_length < 256;
+    std::string name(ok ? name_length : 0, '\0');
+    ok = ok && fread(&name[0], 1, name_length, file) == name_length;
+    int id = 0;
+    while (ok && id < DASH_KERNEL_COUNT && name != dash_kernel_registry[id].name) {
+      id++;
+    }
+    // Kernels this build doesn't have, or whose arguments have changed, only matter if the stream calls them
+    kernel_ids.push_back((id < DASH_KERNEL_COUNT && dash_kernel_registry[id].num_args == num_args) ? id : -1);
+  }
+  uint64_t call_count = 0;
+  ok = ok && fread(&call_count, sizeof(call_count), 1, file) == 1;
+  if (!ok) {
+    fprintf(stderr, "[cedr] %s is not a kernel stream\n", path);
+  }
+  calls.clear();
+  for (uint64_t c = 0; ok && c < call_count; c++) {
+    recorded_call_t call;
+    ok = fread(&call.arrival_ns, sizeof(call.arrival_ns), 1, file) == 1 &&
+         fread(&call.app_instance, sizeof(call.app_instance), 1, file) == 1 &&
+         fread(&call.priority, sizeof(call.priority), 1, file) == 1 &&
+         fread(&call.kernel_id, sizeof(call.kernel_id), 1, file) == 1 && call.kernel_id < kernel_ids.size();
+    if (ok && kernel_ids[call.kernel_id] < 0) {
+      fprintf(stderr, "[cedr] %s calls a kernel this runtime can't run\n", path);
+      ok = false;
+      break;
+    }
+    if (ok) {
+      call.kernel_id = (uint32_t) kernel_ids[call.kernel_id];
+      size_t num_args = dash_kernel_registry[call.kernel_id].num_args;
+      ok = fread(call.values, sizeof(uint64_t), num_args, file) == num_args;
+      calls.push_back(call);
+    }
+    if (!ok) {
+      fprintf(stderr, "[cedr] %s is truncated after %llu calls\n", path, (unsigned long long) c);
+    }
+  }
+  fclose(file);
+  return ok;
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * Launch manifests describe a mix of applications to run in one runtime. Each line launches one shared object, '#'
+ * starts a comment:
+ *   <app.so> <instances> [jobs=<n>] [period=<ms>] [deadline=<ms>] [priority=<high|normal|low>] [-- <app args>...]
+ * Every instance calls the application's main jobs times (default 1). With a period, the instance releases a job every
+ * period milliseconds (waiting for the previous job if it overruns); without one, jobs run back to back. A job misses
+ * its deadline if it completes more than deadline milliseconds after its release, which defaults to the period. The
+ * kernels of higher priority applications are scheduled ahead of lower priority ones. For example
+ *   radar.so     1  jobs=500 period=10 deadline=8 priority=high
+ *   load_gen.so  4  priority=low -- mix=GEMM:1 requests=2000
+ */
+enum app_priority_t {
+  PRIORITY_HIGH,
+  PRIORITY_NORMAL,
+  PRIORITY_LOW,
+  PRIORITY_LEVELS
+};
+
+struct app_spec_t {
+  std::string path;
+  int instances;
+  int jobs;
+  double period_ms;
+  double deadline_ms;
+  app_priority_t priority;
+  std::vector<std::string> args;
+};
+
+static inline bool parse_app_priority(const char* name, app_priority_t* priority) {
+  if (strcmp(name, "high") == 0) {
+    *priority = PRIORITY_HIGH;
+  } else if (strcmp(name, "normal") == 0) {
+    *priority = PRIORITY_NORMAL;
+  } else if (strcmp(name, "low") == 0) {
+    *priority = PRIORITY_LOW;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static inline const char* app_priority_name(app_priority_t priority) {
+  static const char* names[PRIORITY_LEVELS] = {"high", "normal", "low"};
+  return names[priority];
+}
+
+// A single instance of an application running one job at normal priority, as launched from the command line
+static inline app_spec_t default_app_spec(const std::string& path, int instances) {
+  app_spec_t app;
+  app.path = path;
+  app.instances = instances;
+  app.jobs = 1;
+  app.period_ms = 0;
+  app.deadline_ms = 0;
+  app.priority = PRIORITY_NORMAL;
+  return app;
+}
+
+static inline bool parse_app_option(const char* token, app_spec_t* app) {
+  const char* value = strchr(token, '=');
+  if (value == nullptr) {
+    return false;
+  }
+  std::string key(token, value - token);
+  value++;
+  char* end;
+  if (key == "priority") {
+    return parse_app_priority(value, &app->priority);
+  }
+  double number = strtod(value, &end);
+  if (end == value || *end != '\0' || number < 0) {
+    return false;
+  }
+  if (key == "jobs") {
+    app->jobs = (int) number;
+    return app->jobs > 0;
+  } else if (key == "period") {
+    app->period_ms = number;
+  } else if (key == "deadline") {
+    app->deadline_ms = number;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Reads the applications to launch from a manifest, reporting the offending line on error
+static inline bool load_launch_manifest(const char* path, std::vector<app_spec_t>& apps) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    fprintf(stderr, "[cedr] Unable to open launch manifest %s\n", path);
+    return false;
+  }
+  apps.clear();
+  char line[4096];
+  int line_number = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file) != nullptr) {
+    line_number++;
+    char* comment = strchr(line, '#');
+    if (comment != nullptr) {
+      *comment = '\0';
+    }
+    char* saveptr;
+    char* name = strtok_r(line, " \t\r\n", &saveptr);
+    if (name == nullptr) {
+      continue;
+    }
+    char* count = strtok_r(nullptr, " \t\r\n", &saveptr);
+    app_spec_t app = default_app_spec(name, (count != nullptr) ? atoi(count) : 0);
+    bool deadline_given = false;
+    ok = app.instances > 0;
+    bool app_args = false;
+    for (char* token = strtok_r(nullptr, " \t\r\n", &saveptr); ok && token != nullptr; token = strtok_r(nullptr, " \t\r\n", &saveptr)) {
+      if (app_args) {
+        app.args.push_back(token);
+      } else if (strcmp(token, "--") == 0) {
+        app_args = true;
+      } else {
+        ok = parse_app_option(token, &app);
+        deadline_given = deadline_given || strncmp(token, "deadline=", strlen("deadline=")) == 0;
+      }
+    }
+    if (ok) {
+      if (!deadline_given) {
+        app.deadline_ms = app.period_ms;
+      }
+      apps.push_back(app);
+    } else {
+      fprintf(stderr, "[cedr] %s:%d: expected \"<app.so> <instances> [jobs=<n>] [period=<ms>] [deadline=<ms>] "
+              "[priority=<high|normal|low>] [-- <app args>...]\"\n", path, line_number);
+    }
+  }
+  fclose(file);
+  if (ok && apps.empty()) {
+    fprintf(stderr, "[cedr] %s does not launch any applications\n", path);
+    ok = false;
+  }
+  return ok;
+}
@@ -1,117 +1,152 @@
 #include "dash.h"
+#include "dash_completion.h"
+#include "dash_kernels.h"
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
 #include <gsl/gsl_fft_complex.h>
-#include <pthread.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #if !defined(CPU_ONLY)
-extern void enqueue_kernel(const char* kernel_name, ...);
+extern void enqueue_kernel(dash_kernel_id_t kernel_id, ...);
+extern void enqueue_graph(const dash_graph_node_t* nodes, std::atomic<size_t>* waiting, size_t count,
+                          dash_completion_t* completion);
 #endif
 
-void DASH_FFT_cpu(double** input, double** output, size_t* size, bool* isForwardTransform) {
-  thread_local double* data;
-  data = (double *)malloc((*size)*2*sizeof(double));
+/*
+ * GSL's mixed-radix FFT needs a wavetable (factorization of the size plus twiddle factors) and a workspace for every
+ * transform size, and building them costs far more than a small transform. Each thread therefore keeps the plans for
+ * the sizes it used most recently. A wavetable serves both forward and inverse transforms of its size.
+ */
+#define DASH_FFT_PLAN_CACHE_SIZE 8
+
+struct dash_fft_plan {
+  size_t size;
+  gsl_fft_complex_wavetable* wavetable;
+  gsl_fft_complex_workspace* workspace;
+  unsigned long last_used;
+};
+
+struct dash_fft_plan_cache {
+  dash_fft_plan plans[DASH_FFT_PLAN_CACHE_SIZE] = {};
+  unsigned long uses = 0;
+
+  ~dash_fft_plan_cache() {
+    for (size_t i = 0; i < DASH_FFT_PLAN_CACHE_SIZE; i++) {
+      if (plans[i].wavetable != nullptr) {
+        gsl_fft_complex_wavetable_free(plans[i].wavetable);
+        gsl_fft_complex_workspace_free(plans[i].workspace);
+      }
+    }
+  }
+};
+static thread_local dash_fft_plan_cache fft_plan_cache;
+
+static dash_fft_plan* dash_fft_get_plan(size_t size) {
+  dash_fft_plan_cache* cache = &fft_plan_cache;
+  dash_fft_plan* victim = &cache->plans[0];
+  cache->uses++;
+
+  for (size_t i = 0; i < DASH_FFT_PLAN_CACHE_SIZE; i++) {
+    dash_fft_plan* plan = &cache->plans[i];
+    if (plan->wavetable != nullptr && plan->size == size) {
+      plan->last_used = cache->uses;
+      return plan;
+    }
+    // Prefer an empty slot, otherwise evict the least recently used plan
+    if (victim->wavetable != nullptr && (plan->wavetable == nullptr || plan->last_used < victim->last_used)) {
+      victim = plan;
+    }
+  }
+
+  if (victim->wavetable != nullptr) {
+    gsl_fft_complex_wavetable_free(victim->wavetable);
+    gsl_fft_complex_workspace_free(victim->workspace);
+  }
+  victim->size = size;
+  victim->wavetable = gsl_fft_complex_wavetable_alloc(size);
+  victim->workspace = gsl_fft_complex_workspace_alloc(size);
+  if (victim->wavetable == nullptr || victim->workspace == nullptr) {
+    fprintf(stderr, "[libdash] Failed to create a libgsl FFT plan of size %zu!\n", size);
+    exit(1);
+  }
+  victim->last_used = cache->uses;
+  return victim;
+}
 
-  for (size_t i=0; i < (*size); i++){
-    data[2*i] = (*input)[2*i];  
-    data[(2*i)+1] = (*input)[(2*i)+1];
+void DASH_FFT_cpu(double** input, double** output, size_t* size, bool* isForwardTransform) {
+  // Transform in place in the output buffer, so only an out-of-place call pays for a copy
+  double* data = *output;
+  if (*input != *output) {
+    memcpy(data, *input, (*size) * 2 * sizeof(double));
   }
 
+  dash_fft_plan* plan = dash_fft_get_plan(*size);
+
   int check;
   if (*isForwardTransform) {
-    check = gsl_fft_complex_radix2_forward(data, 1, (*size));
+    check = gsl_fft_complex_forward(data, 1, (*size), plan->wavetable, plan->workspace);
   } else {
-    check = gsl_fft_complex_radix2_inverse(data, 1, (*size));
+    check = gsl_fft_complex_inverse(data, 1, (*size), plan->wavetable, plan->workspace);
   }
     
   if (check != 0){
     fprintf(stderr, "[libdash] Failed to complete DASH_FFT_cpu using libgsl with message %d!\n", check);
     exit(1);
   }
-
-  for (size_t i=0; i < (*size); i++){
-    (*output)[2*i] = data[2*i];  
-    (*output)[(2*i)+1] = data[(2*i)+1];
-  }
-  free(data);
-  return;
 }
 
+// Blocked, SIMD implementation lives in dash_gemm.cpp
+void DASH_GEMM_cpu(double** A_re, double** A_im, double** B_re, double** B_im, double** C_re, double** C_im, size_t* A_ROWS, size_t* A_COLS, size_t* B_COLS);
 
-void DASH_GEMM_cpu(double** A_re, double** A_im, double** B_re, double** B_im, double** C_re, double** C_im, size_t* A_ROWS, size_t* A_COLS, size_t* B_COLS) {
-  double res1, res2, res3, res4;
-  double term1, term2, term3, term4;
+// Op-specialized, SIMD implementation lives in dash_zip.cpp
+void DASH_ZIP_cpu(double** input_1, double** input_2, double** output, size_t* size, zip_op_t* op);
 
-  for (int i = 0; i < (*A_ROWS); i++) {
-    for (int j = 0; j < (*B_COLS); j++) {
-      res1 = 0; res2 = 0; res3 = 0; res4 = 0;
-      // A_COLS better equal B_ROWS, I'm trusting you here >:(
-      for (int k = 0; k < (*A_COLS); k++) {
-        term1 = (*A_re)[i * (*A_COLS) + k] * (*B_re)[k * (*B_COLS) + j];
-        res1 += term1;
+// Tiled, separable and FFT-based implementations live in dash_conv.cpp
+void DASH_CONV_2D_cpu(double** input, int* height, int* width, double** mask, int* mask_size, double** output);
+void DASH_CONV_2D_rows_cpu(double** input, int* height, int* width, double** mask, int* mask_size, double** output, int* row_begin, int* row_end);
 
-        term2 = (*A_im)[i * (*A_COLS) + k] * (*B_im)[k * (*B_COLS) + j];
-        res2 += term2;
+// Every transform of a batch is done with the same plan, looked up once
+void DASH_FFT_BATCH_cpu(double** input, double** output, size_t* size, size_t* batch, bool* isForwardTransform) {
+  double* data = *output;
+  if (*input != *output) {
+    memcpy(data, *input, (*size) * 2 * (*batch) * sizeof(double));
+  }
 
-        term3 = (*A_re)[i * (*A_COLS) + k] * (*B_im)[k * (*B_COLS) + j];
-        res3 += term3;
+  dash_fft_plan* plan = dash_fft_get_plan(*size);
 
-        term4 = (*A_im)[i * (*A_COLS) + k] * (*B_re)[k * (*B_COLS) + j];
-        res4 += term4;
-      }
-      (*C_re)[i * (*B_COLS) + j] = res1 - res2;
-      (*C_im)[i * (*B_COLS) + j] = res3 + res4;
+  for (size_t b = 0; b < *batch; b++) {
+    double* transform = data + 2 * (*size) * b;
+    int check;
+    if (*isForwardTransform) {
+      check = gsl_fft_complex_forward(transform, 1, (*size), plan->wavetable, plan->workspace);
+    } else {
+      check = gsl_fft_complex_inverse(transform, 1, (*size), plan->wavetable, plan->workspace);
     }
-  }
-}
-
-void DASH_ZIP_cpu(double** input_1, double** input_2, double** output, size_t* size, zip_op_t* op) {
-  for (size_t i = 0; i < *size; i++) {
-    switch (*op) {
-      case ZIP_ADD:
-        (*output)[i] = (*input_1)[i] + (*input_2)[i];
-        break;
-      case ZIP_SUB:
-        (*output)[i] = (*input_1)[i] - (*input_2)[i];
-        break;
-      case ZIP_MULT:
-        (*output)[i] = (*input_1)[i] * (*input_2)[i];
-        break;
-      case ZIP_DIV:
-        (*output)[i] = (*input_1)[i] / (*input_2)[i];
-        break;
-      case ZIP_CMP_MULT:
-        (*output)[i*2] = (*input_1)[i*2] * (*input_2)[i*2] - (*input_1)[i*2+1] * (*input_2)[i*2+1];
-        (*output)[i*2+1] = (*input_1)[i*2+1] * (*input_2)[i*2] + (*input_1)[i*2] * (*input_2)[i*2+1];
-        break;
+    if (check != 0) {
+      fprintf(stderr, "[libdash] Failed to complete DASH_FFT_BATCH_cpu using libgsl with message %d!\n", check);
+      exit(1);
     }
   }
 }
 
-void DASH_CONV_2D_cpu(double **input, int *height, int *width, double **mask, int *mask_size, double **output) {
-  int i, j, k, l;
-  int s, w;
-  int z;
-
-  z = (*mask_size) / 2;
-
-  for (i = 0; i < (*height); i++) {
-    for (j = 0; j < (*width); j++) {
-      (*output)[i * (*width) + j] = 0;
-      for (k = 0; k < (*mask_size); k++) {
-        for (l = 0; l < (*mask_size); l++) {
-          s = i + k - z;
-          w = j + l - z;
-          if ((s >= 0 && s < (*height)) && (w >= 0 && w < (*width))) {
-            (*output)[i * (*width) + j] += (*input)[(*width) * s + w] * (*mask)[(*mask_size) * k + l];
-          }
-        }
-      }
-    }
+void DASH_GEMM_BATCH_cpu(double** A_re, double** A_im, double** B_re, double** B_im, double** C_re, double** C_im, size_t* A_ROWS, size_t* A_COLS, size_t* B_COLS, size_t* batch) {
+  size_t a_elements = (*A_ROWS) * (*A_COLS), b_elements = (*A_COLS) * (*B_COLS), c_elements = (*A_ROWS) * (*B_COLS);
+  for (size_t b = 0; b < *batch; b++) {
+    double* a_re = *A_re + a_elements * b;
+    double* a_im = *A_im + a_elements * b;
+    double* b_re = *B_re + b_elements * b;
+    double* b_im = *B_im + b_elements * b;
+    double* c_re = *C_re + c_elements * b;
+    double* c_im = *C_im + c_elements * b;
+    DASH_GEMM_cpu(&a_re, &a_im, &b_re, &b_im, &c_re, &c_im, A_ROWS, A_COLS, B_COLS);
   }
 }
 
@@ -119,11 +154,10 @@ void DASH_FFT(double* input, double* output, size_t size, bool isForwardTransfor
 #if defined(CPU_ONLY)
   DASH_FFT_cpu(&input, &output, &size, &isForwardTransform);
 #else
-  pthread_barrier_t barrier;
-  pthread_barrier_init(&barrier, nullptr, 2);
-  enqueue_kernel("DASH_FFT", &input, &output, &size, &isForwardTransform, &barrier);
-  pthread_barrier_wait(&barrier);
-  pthread_barrier_destroy(&barrier);
+  dash_completion_t completion;
+  dash_completion_init(&completion);
+  enqueue_kernel(DASH_KERNEL_FFT, &input, &output, &size, &isForwardTransform, &completion);
+  dash_completion_wait(&completion);
 #endif
 }
 
@@ -131,11 +165,10 @@ void DASH_GEMM(double* A_re, double* A_im, double* B_re, double* B_im, double* C
 #if defined(CPU_ONLY)
   DASH_GEMM_cpu(&A_re, &A_im, &B_re, &B_im, &C_re, &C_im, &Row_A, &Col_A, &Col_B);
 #else
-  pthread_barrier_t barrier;
-  pthread_barrier_init(&barrier, nullptr, 2);
-  enqueue_kernel("DASH_GEMM", &A_re, &A_im, &B_re, &B_im, &C_re, &C_im, &Row_A, &Col_A, &Col_B, &barrier);
-  pthread_barrier_wait(&barrier);
-  pthread_barrier_destroy(&barrier);
+  dash_completion_t completion;
+  dash_completion_init(&completion);
+  enqueue_kernel(DASH_KERNEL_GEMM, &A_re, &A_im, &B_re, &B_im, &C_re, &C_im, &Row_A, &Col_A, &Col_B, &completion);
+  dash_completion_wait(&completion);
 #endif
 }
 
@@ -143,11 +176,10 @@ void DASH_ZIP(double* input_1, double* input_2, double* output, size_t size, zip
 #if defined(CPU_ONLY)
   DASH_ZIP_cpu(&input_1, &input_2, &output, &size, &op);
 #else
-  pthread_barrier_t barrier;
-  pthread_barrier_init(&barrier, nullptr, 2);
-  enqueue_kernel("DASH_ZIP", &input_1, &input_2, &output, &size, &op, &barrier);
-  pthread_barrier_wait(&barrier);
-  pthread_barrier_destroy(&barrier);
+  dash_completion_t completion;
+  dash_completion_init(&completion);
+  enqueue_kernel(DASH_KERNEL_ZIP, &input_1, &input_2, &output, &size, &op, &completion);
+  dash_completion_wait(&completion);
 #endif
 }
 
@@ -155,15 +187,733 @@ void DASH_CONV_2D(double *input, int height, int width, double *mask, int mask_s
 #if defined(CPU_ONLY)
   DASH_CONV_2D_cpu(&input, &height, &width, &mask, &mask_size, &output);
 #else
-  pthread_barrier_t barrier;
-  pthread_barrier_init(&barrier, nullptr, 2);
-  enqueue_kernel("DASH_CONV_2D", &input, &height, &width, &mask, &mask_size, &output, &barrier);
-  pthread_barrier_wait(&barrier);
-  pthread_barrier_destroy(&barrier);
+  dash_completion_t completion;
+  dash_completion_init(&completion);
+  enqueue_kernel(DASH_KERNEL_CONV_2D, &input, &height, &width, &mask, &mask_size, &output, &completion);
+  dash_completion_wait(&completion);
+#endif
+}
+void DASH_FFT_BATCH(double* input, double* output, size_t size, size_t batch, bool isForwardTransform) {
+#if defined(CPU_ONLY)
+  DASH_FFT_BATCH_cpu(&input, &output, &size, &batch, &isForwardTransform);
+#else
+  dash_completion_t completion;
+  dash_completion_init(&completion);
+  enqueue_kernel(DASH_KERNEL_FFT_BATCH, &input, &output, &size, &batch, &isForwardTransform, &completion);
+  dash_completion_wait(&completion);
+#endif
+}
+
+void DASH_GEMM_BATCH(double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B, size_t batch) {
+#if defined(CPU_ONLY)
+  DASH_GEMM_BATCH_cpu(&A_re, &A_im, &B_re, &B_im, &C_re, &C_im, &Row_A, &Col_A, &Col_B, &batch);
+#else
+  dash_completion_t completion;
+  dash_completion_init(&completion);
+  enqueue_kernel(DASH_KERNEL_GEMM_BATCH, &A_re, &A_im, &B_re, &B_im, &C_re, &C_im, &Row_A, &Col_A, &Col_B, &batch, &completion);
+  dash_completion_wait(&completion);
 #endif
 }
 /* End of baseline API implementations */
 
+/*
+ * Work estimates of each kernel, in multiply-adds (elements touched for ZIP), the extents of their buffers, and the
+ * splitters the runtime uses to divide large calls across workers (see dash_kernel_splitter_t).
+ * ZIP is split into element ranges, GEMM into panels of rows of A and C, and CONV_2D into bands of output rows, each of
+ * which reads the input rows it needs around the band. Batches are split into runs of whole problems.
+ */
+static size_t dash_fft_work(void* const* args) {
+  size_t size = *(size_t*) args[2];
+  size_t log_size = 0;
+  while (((size_t) 1 << log_size) < size) {
+    log_size++;
+  }
+  return size * (log_size > 0 ? log_size : 1);
+}
+
+static void dash_fft_buffers(void* const* args, dash_buffer_extent_t* extents) {
+  size_t size = *(size_t*) args[2];
+  extents[0] = dash_buffer_extent_t{2 * size, false};
+  extents[1] = dash_buffer_extent_t{2 * size, true};
+}
+
+static bool dash_zip_is_complex(zip_op_t op) {
+  return op == ZIP_CMP_MULT || op == ZIP_CMP_CONJ_MULT || op == ZIP_CMP_MAG;
+}
+
+static size_t dash_zip_work(void* const* args) {
+  size_t size = *(size_t*) args[3];
+  return dash_zip_is_complex(*(zip_op_t*) args[4]) ? 2 * size : size;
+}
+
+static void dash_zip_buffers(void* const* args, dash_buffer_extent_t* extents) {
+  size_t size = *(size_t*) args[3];
+  zip_op_t op = *(zip_op_t*) args[4];
+  size_t length = dash_zip_is_complex(op) ? 2 * size : size;
+  extents[0] = dash_buffer_extent_t{length, false};
+  // ZIP_SCALE only reads its factor from input_2[0], and ZIP_CMP_MAG doesn't read input_2 at all
+  extents[1] = dash_buffer_extent_t{(op == ZIP_SCALE) ? 1 : (op == ZIP_CMP_MAG) ? 0 : length, false};
+  extents[2] = dash_buffer_extent_t{(op == ZIP_CMP_MAG) ? size : length, true};
+}
+
+static size_t dash_zip_units(void* const* args) {
+  size_t size = *(size_t*) args[3];
+  // ZIP_CMP_MAG writes half as much as it reads, so in place, a part's output overwrites the input of earlier elements
+  // that another part may not have read yet: such a call runs as one part
+  if (*(zip_op_t*) args[4] == ZIP_CMP_MAG) {
+    const double* input = *(double**) args[0];
+    const double* output = *(double**) args[2];
+    if (output < input + 2 * size && input < output + size) {
+      return 1;
+    }
+  }
+  return size;
+}
+
+static void dash_zip_part(void* const* args, size_t begin, size_t end, void** part_args, dash_arg_value_t* values) {
+  zip_op_t op = *(zip_op_t*) args[4];
+  size_t input_stride = dash_zip_is_complex(op) ? 2 : 1;
+  size_t output_stride = (op == ZIP_CMP_MAG) ? 1 : input_stride;
+
+  values[0].f64_buffer = *(double**) args[0] + input_stride * begin;
+  part_args[0] = &values[0].f64_buffer;
+  // ZIP_SCALE always reads its factor from input_2[0], and ZIP_CMP_MAG doesn't read input_2 at all
+  if (op == ZIP_SCALE || op == ZIP_CMP_MAG) {
+    part_args[1] = args[1];
+  } else {
+    values[1].f64_buffer = *(double**) args[1] + input_stride * begin;
+    part_args[1] = &values[1].f64_buffer;
+  }
+  values[2].f64_buffer = *(double**) args[2] + output_stride * begin;
+  part_args[2] = &values[2].f64_buffer;
+  values[3].size = end - begin;
+  part_args[3] = &values[3].size;
+  part_args[4] = args[4];
+}
+
+static const dash_kernel_splitter_t DASH_ZIP_splitter = {dash_zip_units, dash_zip_part, nullptr};
+
+static size_t dash_gemm_work(void* const* args) {
+  return *(size_t*) args[6] * *(size_t*) args[7] * *(size_t*) args[8];
+}
+
+static void dash_gemm_buffers(void* const* args, dash_buffer_extent_t* extents) {
+  size_t a_rows = *(size_t*) args[6], a_cols = *(size_t*) args[7], b_cols = *(size_t*) args[8];
+  extents[0] = extents[1] = dash_buffer_extent_t{a_rows * a_cols, false};
+  extents[2] = extents[3] = dash_buffer_extent_t{a_cols * b_cols, false};
+  extents[4] = extents[5] = dash_buffer_extent_t{a_rows * b_cols, true};
+}
+
+static size_t dash_gemm_units(void* const* args) {
+  return *(size_t*) args[6];
+}
+
+static void dash_gemm_part(void* const* args, size_t begin, size_t end, void** part_args, dash_arg_value_t* values) {
+  size_t a_cols = *(size_t*) args[7];
+  size_t b_cols = *(size_t*) args[8];
+  for (size_t i = 0; i < 9; i++) {
+    part_args[i] = args[i];
+  }
+  // Rows [begin, end) of A and C; all of B
+  values[0].f64_buffer = *(double**) args[0] + begin * a_cols;
+  values[1].f64_buffer = *(double**) args[1] + begin * a_cols;
+  values[4].f64_buffer = *(double**) args[4] + begin * b_cols;
+  values[5].f64_buffer = *(double**) args[5] + begin * b_cols;
+  values[6].size = end - begin;
+  part_args[0] = &values[0].f64_buffer;
+  part_args[1] = &values[1].f64_buffer;
+  part_args[4] = &values[4].f64_buffer;
+  part_args[5] = &values[5].f64_buffer;
+  part_args[6] = &values[6].size;
+}
+
+static const dash_kernel_splitter_t DASH_GEMM_splitter = {dash_gemm_units, dash_gemm_part, nullptr};
+
+static size_t dash_conv_2d_work(void* const* args) {
+  size_t height = *(int*) args[1] > 0 ? *(int*) args[1] : 0;
+  size_t width = *(int*) args[2] > 0 ? *(int*) args[2] : 0;
+  size_t mask_size = *(int*) args[4] > 0 ? *(int*) args[4] : 0;
+  return height * width * mask_size * mask_size;
+}
+
+static void dash_conv_2d_buffers(void* const* args, dash_buffer_extent_t* extents) {
+  size_t height = *(int*) args[1] > 0 ? *(int*) args[1] : 0;
+  size_t width = *(int*) args[2] > 0 ? *(int*) args[2] : 0;
+  size_t mask_size = *(int*) args[4] > 0 ? *(int*) args[4] : 0;
+  extents[0] = dash_buffer_extent_t{height * width, false};
+  extents[3] = dash_buffer_extent_t{mask_size * mask_size, false};
+  extents[5] = dash_buffer_extent_t{height * width, true};
+}
+
+static size_t dash_conv_2d_units(void* const* args) {
+  return *(int*) args[1] > 0 ? *(int*) args[1] : 0;
+}
+
+static void dash_conv_2d_part(void* const* args, size_t begin, size_t end, void** part_args, dash_arg_value_t* values) {
+  for (size_t i = 0; i < 6; i++) {
+    part_args[i] = args[i];
+  }
+  values[6].integer = (int) begin;
+  values[7].integer = (int) end;
+  part_args[6] = &values[6].integer;
+  part_args[7] = &values[7].integer;
+}
+
+static const dash_kernel_splitter_t DASH_CONV_2D_splitter = {dash_conv_2d_units, dash_conv_2d_part, (void*) DASH_CONV_2D_rows_cpu};
+
+static size_t dash_fft_batch_work(void* const* args) {
+  return dash_fft_work(args) * *(size_t*) args[3];
+}
+
+static void dash_fft_batch_buffers(void* const* args, dash_buffer_extent_t* extents) {
+  size_t length = 2 * *(size_t*) args[2] * *(size_t*) args[3];
+  extents[0] = dash_buffer_extent_t{length, false};
+  extents[1] = dash_buffer_extent_t{length, true};
+}
+
+static size_t dash_fft_batch_units(void* const* args) {
+  return *(size_t*) args[3];
+}
+
+static void dash_fft_batch_part(void* const* args, size_t begin, size_t end, void** part_args, dash_arg_value_t* values) {
+  size_t transform_length = 2 * *(size_t*) args[2];
+  values[0].f64_buffer = *(double**) args[0] + transform_length * begin;
+  values[1].f64_buffer = *(double**) args[1] + transform_length * begin;
+  values[3].size = end - begin;
+  part_args[0] = &values[0].f64_buffer;
+  part_args[1] = &values[1].f64_buffer;
+  part_args[2] = args[2];
+  part_args[3] = &values[3].size;
+  part_args[4] = args[4];
+}
+
+static const dash_kernel_splitter_t DASH_FFT_BATCH_splitter = {dash_fft_batch_units, dash_fft_batch_part, nullptr};
+
+static size_t dash_gemm_batch_work(void* const* args) {
+  return dash_gemm_work(args) * *(size_t*) args[9];
+}
+
+static void dash_gemm_batch_buffers(void* const* args, dash_buffer_extent_t* extents) {
+  size_t batch = *(size_t*) args[9];
+  dash_gemm_buffers(args, extents);
+  for (size_t i = 0; i < 6; i++) {
+    extents[i].length *= batch;
+  }
+}
+
+static size_t dash_gemm_batch_units(void* const* args) {
+  return *(size_t*) args[9];
+}
+
+static void dash_gemm_batch_part(void* const* args, size_t begin, size_t end, void** part_args, dash_arg_value_t* values) {
+  size_t a_elements = *(size_t*) args[6] * *(size_t*) args[7];
+  size_t b_elements = *(size_t*) args[7] * *(size_t*) args[8];
+  size_t c_elements = *(size_t*) args[6] * *(size_t*) args[8];
+  const size_t elements[6] = {a_elements, a_elements, b_elements, b_elements, c_elements, c_elements};
+  for (size_t i = 0; i < 6; i++) {
+    values[i].f64_buffer = *(double**) args[i] + elements[i] * begin;
+    part_args[i] = &values[i].f64_buffer;
+  }
+  part_args[6] = args[6];
+  part_args[7] = args[7];
+  part_args[8] = args[8];
+  values[9].size = end - begin;
+  part_args[9] = &values[9].size;
+}
+
+static const dash_kernel_splitter_t DASH_GEMM_BATCH_splitter = {dash_gemm_batch_units, dash_gemm_batch_part, nullptr};
+
+/* Kernel registry, generated from dash_kernels.def */
+#define DASH_KERNEL(name, cpu_impl, work, buffers, splitter, ...) static const dash_arg_kind_t name##_arg_kinds[] = {__VA_ARGS__};
+#include "dash_kernels.def"
+#undef DASH_KERNEL
+
+const dash_kernel_descriptor_t dash_kernel_registry[DASH_KERNEL_COUNT] = {
+#define DASH_KERNEL(name, cpu_impl, work, buffers, splitter, ...) {#name, sizeof(name##_arg_kinds) / sizeof(dash_arg_kind_t), name##_arg_kinds, (void*) cpu_impl, work, buffers, splitter},
+#include "dash_kernels.def"
+#undef DASH_KERNEL
+};
+
+/*
+ * Async API implementations
+ * The runtime reads kernel arguments through pointers when the task executes, so unlike the synchronous wrappers
+ * (which keep them on their own stack) every request owns a copy of its arguments.
+ */
+union dash_call_args {
+  struct {
+    double* input;
+    double* output;
+    size_t size;
+    bool isForwardTransform;
+  } fft;
+  struct {
+    double* A_re;
+    double* A_im;
+    double* B_re;
+    double* B_im;
+    double* C_re;
+    double* C_im;
+    size_t Row_A;
+    size_t Col_A;
+    size_t Col_B;
+  } gemm;
+  struct {
+    double* input_1;
+    double* input_2;
+    double* output;
+    size_t size;
+    zip_op_t op;
+  } zip;
+  struct {
+    double* input;
+    int height;
+    int width;
+    double* mask;
+    int mask_size;
+    double* output;
+  } conv_2d;
+  struct {
+    double* input;
+    double* output;
+    size_t size;
+    size_t batch;
+    bool isForwardTransform;
+  } fft_batch;
+  struct {
+    double* A_re;
+    double* A_im;
+    double* B_re;
+    double* B_im;
+    double* C_re;
+    double* C_im;
+    size_t Row_A;
+    size_t Col_A;
+    size_t Col_B;
+    size_t batch;
+  } gemm_batch;
+};
+
+struct dash_request {
+  dash_completion_t completion;
+  dash_call_args args;
+};
+
+// Released requests are cached per thread so that steady-state async dispatch doesn't touch the heap
+#define DASH_REQUEST_CACHE_SIZE 64
+
+struct dash_request_cache {
+  dash_req_t requests[DASH_REQUEST_CACHE_SIZE];
+  size_t count = 0;
+
+  ~dash_request_cache() {
+    for (size_t i = 0; i < count; i++) {
+      free(requests[i]);
+    }
+  }
+};
+static thread_local dash_request_cache request_cache;
+
+static dash_req_t dash_request_alloc() {
+  dash_req_t request;
+  if (request_cache.count > 0) {
+    request = request_cache.requests[--request_cache.count];
+  } else {
+    request = (dash_req_t) malloc(sizeof(struct dash_request));
+    if (request == nullptr) {
+      fprintf(stderr, "[libdash] Failed to allocate an async request!\n");
+      exit(1);
+    }
+  }
+  dash_completion_init(&request->completion);
+  return request;
+}
+
+static void dash_request_release(dash_req_t request) {
+  if (request_cache.count < DASH_REQUEST_CACHE_SIZE) {
+    request_cache.requests[request_cache.count++] = request;
+  } else {
+    free(request);
+  }
+}
+
+dash_req_t DASH_FFT_async(double* input, double* output, size_t size, bool isForwardTransform) {
+  dash_req_t request = dash_request_alloc();
+  request->args.fft.input = input;
+  request->args.fft.output = output;
+  request->args.fft.size = size;
+  request->args.fft.isForwardTransform = isForwardTransform;
+#if defined(CPU_ONLY)
+  DASH_FFT_cpu(&request->args.fft.input, &request->args.fft.output, &request->args.fft.size, &request->args.fft.isForwardTransform);
+  dash_completion_signal(&request->completion);
+#else
+  enqueue_kernel(DASH_KERNEL_FFT, &request->args.fft.input, &request->args.fft.output, &request->args.fft.size,
+                 &request->args.fft.isForwardTransform, &request->completion);
+#endif
+  return request;
+}
+
+dash_req_t DASH_GEMM_async(double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B) {
+  dash_req_t request = dash_request_alloc();
+  request->args.gemm.A_re = A_re;
+  request->args.gemm.A_im = A_im;
+  request->args.gemm.B_re = B_re;
+  request->args.gemm.B_im = B_im;
+  request->args.gemm.C_re = C_re;
+  request->args.gemm.C_im = C_im;
+  request->args.gemm.Row_A = Row_A;
+  request->args.gemm.Col_A = Col_A;
+  request->args.gemm.Col_B = Col_B;
+#if defined(CPU_ONLY)
+  DASH_GEMM_cpu(&request->args.gemm.A_re, &request->args.gemm.A_im, &request->args.gemm.B_re, &request->args.gemm.B_im,
+                &request->args.gemm.C_re, &request->args.gemm.C_im, &request->args.gemm.Row_A, &request->args.gemm.Col_A,
+                &request->args.gemm.Col_B);
+  dash_completion_signal(&request->completion);
+#else
+  enqueue_kernel(DASH_KERNEL_GEMM, &request->args.gemm.A_re, &request->args.gemm.A_im, &request->args.gemm.B_re, &request->args.gemm.B_im,
+                 &request->args.gemm.C_re, &request->args.gemm.C_im, &request->args.gemm.Row_A, &request->args.gemm.Col_A,
+                 &request->args.gemm.Col_B, &request->completion);
+#endif
+  return request;
+}
+
+dash_req_t DASH_ZIP_async(double* input_1, double* input_2, double* output, size_t size, zip_op_t op) {
+  dash_req_t request = dash_request_alloc();
+  request->args.zip.input_1 = input_1;
+  request->args.zip.input_2 = input_2;
+  request->args.zip.output = output;
+  request->args.zip.size = size;
+  request->args.zip.op = op;
+#if defined(CPU_ONLY)
+  DASH_ZIP_cpu(&request->args.zip.input_1, &request->args.zip.input_2, &request->args.zip.output, &request->args.zip.size, &request->args.zip.op);
+  dash_completion_signal(&request->completion);
+#else
+  enqueue_kernel(DASH_KERNEL_ZIP, &request->args.zip.input_1, &request->args.zip.input_2, &request->args.zip.output,
+                 &request->args.zip.size, &request->args.zip.op, &request->completion);
+#endif
+  return request;
+}
+
+dash_req_t DASH_CONV_2D_async(double *input, int height, int width, double *mask, int mask_size, double *output) {
+  dash_req_t request = dash_request_alloc();
+  request->args.conv_2d.input = input;
+  request->args.conv_2d.height = height;
+  request->args.conv_2d.width = width;
+  request->args.conv_2d.mask = mask;
+  request->args.conv_2d.mask_size = mask_size;
+  request->args.conv_2d.output = output;
+#if defined(CPU_ONLY)
+  DASH_CONV_2D_cpu(&request->args.conv_2d.input, &request->args.conv_2d.height, &request->args.conv_2d.width,
+                   &request->args.conv_2d.mask, &request->args.conv_2d.mask_size, &request->args.conv_2d.output);
+  dash_completion_signal(&request->completion);
+#else
+  enqueue_kernel(DASH_KERNEL_CONV_2D, &request->args.conv_2d.input, &request->args.conv_2d.height, &request->args.conv_2d.width,
+                 &request->args.conv_2d.mask, &request->args.conv_2d.mask_size, &request->args.conv_2d.output, &request->completion);
+#endif
+  return request;
+}
+
+dash_req_t DASH_FFT_BATCH_async(double* input, double* output, size_t size, size_t batch, bool isForwardTransform) {
+  dash_req_t request = dash_request_alloc();
+  request->args.fft_batch.input = input;
+  request->args.fft_batch.output = output;
+  request->args.fft_batch.size = size;
+  request->args.fft_batch.batch = batch;
+  request->args.fft_batch.isForwardTransform = isForwardTransform;
+#if defined(CPU_ONLY)
+  DASH_FFT_BATCH_cpu(&request->args.fft_batch.input, &request->args.fft_batch.output, &request->args.fft_batch.size,
+                     &request->args.fft_batch.batch, &request->args.fft_batch.isForwardTransform);
+  dash_completion_signal(&request->completion);
+#else
+  enqueue_kernel(DASH_KERNEL_FFT_BATCH, &request->args.fft_batch.input, &request->args.fft_batch.output, &request->args.fft_batch.size,
+                 &request->args.fft_batch.batch, &request->args.fft_batch.isForwardTransform, &request->completion);
+#endif
+  return request;
+}
+
+dash_req_t DASH_GEMM_BATCH_async(double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B, size_t batch) {
+  dash_req_t request = dash_request_alloc();
+  request->args.gemm_batch.A_re = A_re;
+  request->args.gemm_batch.A_im = A_im;
+  request->args.gemm_batch.B_re = B_re;
+  request->args.gemm_batch.B_im = B_im;
+  request->args.gemm_batch.C_re = C_re;
+  request->args.gemm_batch.C_im = C_im;
+  request->args.gemm_batch.Row_A = Row_A;
+  request->args.gemm_batch.Col_A = Col_A;
+  request->args.gemm_batch.Col_B = Col_B;
+  request->args.gemm_batch.batch = batch;
+#if defined(CPU_ONLY)
+  DASH_GEMM_BATCH_cpu(&request->args.gemm_batch.A_re, &request->args.gemm_batch.A_im, &request->args.gemm_batch.B_re,
+                      &request->args.gemm_batch.B_im, &request->args.gemm_batch.C_re, &request->args.gemm_batch.C_im,
+                      &request->args.gemm_batch.Row_A, &request->args.gemm_batch.Col_A, &request->args.gemm_batch.Col_B,
+                      &request->args.gemm_batch.batch);
+  dash_completion_signal(&request->completion);
+#else
+  enqueue_kernel(DASH_KERNEL_GEMM_BATCH, &request->args.gemm_batch.A_re, &request->args.gemm_batch.A_im, &request->args.gemm_batch.B_re,
+                 &request->args.gemm_batch.B_im, &request->args.gemm_batch.C_re, &request->args.gemm_batch.C_im,
+                 &request->args.gemm_batch.Row_A, &request->args.gemm_batch.Col_A, &request->args.gemm_batch.Col_B,
+                 &request->args.gemm_batch.batch, &request->completion);
+#endif
+  return request;
+}
+
+int DASH_test(dash_req_t request) {
+  return dash_completion_test(&request->completion) ? 1 : 0;
+}
+
+void DASH_wait(dash_req_t request) {
+  dash_completion_wait(&request->completion);
+  dash_request_release(request);
+}
+
+void DASH_wait_all(dash_req_t* requests, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    DASH_wait(requests[i]);
+  }
+}
+/* End of async API implementations */
+
+/*
+ * Task graph implementations
+ * Like a request, a graph owns the arguments of its calls. Each call also notes the memory it reads and writes (as its
+ * kernel's registry entry describes it), which is compared against the calls added before it to find what it depends
+ * on.
+ */
+#define DASH_GRAPH_MAX_ARGS 15
+
+struct dash_buffer_access {
+  const double* begin;
+  const double* end;
+  bool write;
+};
+
+struct dash_graph_call {
+  dash_kernel_id_t kernel_id;
+  dash_call_args args;
+  void* arg_pointers[DASH_GRAPH_MAX_ARGS];
+  dash_buffer_access accesses[DASH_GRAPH_MAX_ARGS];
+  size_t num_accesses;
+  std::vector<size_t> successors;
+  size_t num_predecessors;
+};
+
+struct dash_graph {
+  // A deque keeps every call (and so its arguments) in place as more are added
+  std::deque<dash_graph_call> calls;
+  std::vector<dash_graph_node_t> nodes;
+  // How many predecessors each node is still waiting for while the graph runs; only reallocated when the graph grows
+  std::unique_ptr<std::atomic<size_t>[]> waiting;
+  size_t waiting_capacity = 0;
+};
+
+static dash_graph_call* dash_graph_add(dash_graph_t graph, dash_kernel_id_t kernel_id) {
+  graph->calls.emplace_back();
+  dash_graph_call* call = &graph->calls.back();
+  call->kernel_id = kernel_id;
+  call->num_accesses = 0;
+  call->num_predecessors = 0;
+  return call;
+}
+
+static void dash_graph_note_accesses(dash_graph_call* call) {
+  const dash_kernel_descriptor_t* kernel = &dash_kernel_registry[call->kernel_id];
+  dash_buffer_extent_t extents[DASH_GRAPH_MAX_ARGS];
+  kernel->buffers(call->arg_pointers, extents);
+  for (size_t i = 0; i < kernel->num_args; i++) {
+    if (kernel->arg_kinds[i] == DASH_ARG_F64_BUFFER && extents[i].length > 0) {
+      const double* buffer = *(double**) call->arg_pointers[i];
+      call->accesses[call->num_accesses++] = dash_buffer_access{buffer, buffer + extents[i].length, extents[i].written};
+    }
+  }
+}
+
+static bool dash_graph_conflict(const dash_graph_call* first, const dash_graph_call* second) {
+  for (size_t i = 0; i < first->num_accesses; i++) {
+    for (size_t j = 0; j < second->num_accesses; j++) {
+      const dash_buffer_access& a = first->accesses[i];
+      const dash_buffer_access& b = second->accesses[j];
+      if ((a.write || b.write) && a.begin < b.end && b.begin < a.end) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static void dash_graph_edge(dash_graph_t graph, size_t predecessor, size_t node) {
+  std::vector<size_t>& successors = graph->calls[predecessor].successors;
+  if (std::find(successors.begin(), successors.end(), node) == successors.end()) {
+    successors.push_back(node);
+    graph->calls[node].num_predecessors++;
+  }
+}
+
+// Makes the newest call depend on every earlier call it conflicts with, and returns its index
+static size_t dash_graph_link(dash_graph_t graph) {
+  size_t node = graph->calls.size() - 1;
+  dash_graph_note_accesses(&graph->calls[node]);
+  for (size_t p = 0; p < node; p++) {
+    if (dash_graph_conflict(&graph->calls[p], &graph->calls[node])) {
+      dash_graph_edge(graph, p, node);
+    }
+  }
+  return node;
+}
+
+dash_graph_t DASH_graph_create(void) {
+  return new dash_graph();
+}
+
+void DASH_graph_destroy(dash_graph_t graph) {
+  delete graph;
+}
+
+size_t DASH_graph_FFT(dash_graph_t graph, double* input, double* output, size_t size, bool isForwardTransform) {
+  dash_graph_call* call = dash_graph_add(graph, DASH_KERNEL_FFT);
+  call->args.fft.input = input;
+  call->args.fft.output = output;
+  call->args.fft.size = size;
+  call->args.fft.isForwardTransform = isForwardTransform;
+  call->arg_pointers[0] = &call->args.fft.input;
+  call->arg_pointers[1] = &call->args.fft.output;
+  call->arg_pointers[2] = &call->args.fft.size;
+  call->arg_pointers[3] = &call->args.fft.isForwardTransform;
+  return dash_graph_link(graph);
+}
+
+size_t DASH_graph_GEMM(dash_graph_t graph, double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B) {
+  dash_graph_call* call = dash_graph_add(graph, DASH_KERNEL_GEMM);
+  call->args.gemm.A_re = A_re;
+  call->args.gemm.A_im = A_im;
+  call->args.gemm.B_re = B_re;
+  call->args.gemm.B_im = B_im;
+  call->args.gemm.C_re = C_re;
+  call->args.gemm.C_im = C_im;
+  call->args.gemm.Row_A = Row_A;
+  call->args.gemm.Col_A = Col_A;
+  call->args.gemm.Col_B = Col_B;
+  call->arg_pointers[0] = &call->args.gemm.A_re;
+  call->arg_pointers[1] = &call->args.gemm.A_im;
+  call->arg_pointers[2] = &call->args.gemm.B_re;
+  call->arg_pointers[3] = &call->args.gemm.B_im;
+  call->arg_pointers[4] = &call->args.gemm.C_re;
+  call->arg_pointers[5] = &call->args.gemm.C_im;
+  call->arg_pointers[6] = &call->args.gemm.Row_A;
+  call->arg_pointers[7] = &call->args.gemm.Col_A;
+  call->arg_pointers[8] = &call->args.gemm.Col_B;
+  return dash_graph_link(graph);
+}
+
+size_t DASH_graph_ZIP(dash_graph_t graph, double* input_1, double* input_2, double* output, size_t size, zip_op_t op) {
+  dash_graph_call* call = dash_graph_add(graph, DASH_KERNEL_ZIP);
+  call->args.zip.input_1 = input_1;
+  call->args.zip.input_2 = input_2;
+  call->args.zip.output = output;
+  call->args.zip.size = size;
+  call->args.zip.op = op;
+  call->arg_pointers[0] = &call->args.zip.input_1;
+  call->arg_pointers[1] = &call->args.zip.input_2;
+  call->arg_pointers[2] = &call->args.zip.output;
+  call->arg_pointers[3] = &call->args.zip.size;
+  call->arg_pointers[4] = &call->args.zip.op;
+  return dash_graph_link(graph);
+}
+
+size_t DASH_graph_CONV_2D(dash_graph_t graph, double *input, int height, int width, double *mask, int mask_size, double *output) {
+  dash_graph_call* call = dash_graph_add(graph, DASH_KERNEL_CONV_2D);
+  call->args.conv_2d.input = input;
+  call->args.conv_2d.height = height;
+  call->args.conv_2d.width = width;
+  call->args.conv_2d.mask = mask;
+  call->args.conv_2d.mask_size = mask_size;
+  call->args.conv_2d.output = output;
+  call->arg_pointers[0] = &call->args.conv_2d.input;
+  call->arg_pointers[1] = &call->args.conv_2d.height;
+  call->arg_pointers[2] = &call->args.conv_2d.width;
+  call->arg_pointers[3] = &call->args.conv_2d.mask;
+  call->arg_pointers[4] = &call->args.conv_2d.mask_size;
+  call->arg_pointers[5] = &call->args.conv_2d.output;
+  return dash_graph_link(graph);
+}
+
+size_t DASH_graph_FFT_BATCH(dash_graph_t graph, double* input, double* output, size_t size, size_t batch, bool isForwardTransform) {
+  dash_graph_call* call = dash_graph_add(graph, DASH_KERNEL_FFT_BATCH);
+  call->args.fft_batch.input = input;
+  call->args.fft_batch.output = output;
+  call->args.fft_batch.size = size;
+  call->args.fft_batch.batch = batch;
+  call->args.fft_batch.isForwardTransform = isForwardTransform;
+  call->arg_pointers[0] = &call->args.fft_batch.input;
+  call->arg_pointers[1] = &call->args.fft_batch.output;
+  call->arg_pointers[2] = &call->args.fft_batch.size;
+  call->arg_pointers[3] = &call->args.fft_batch.batch;
+  call->arg_pointers[4] = &call->args.fft_batch.isForwardTransform;
+  return dash_graph_link(graph);
+}
+
+size_t DASH_graph_GEMM_BATCH(dash_graph_t graph, double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B, size_t batch) {
+  dash_graph_call* call = dash_graph_add(graph, DASH_KERNEL_GEMM_BATCH);
+  call->args.gemm_batch.A_re = A_re;
+  call->args.gemm_batch.A_im = A_im;
+  call->args.gemm_batch.B_re = B_re;
+  call->args.gemm_batch.B_im = B_im;
+  call->args.gemm_batch.C_re = C_re;
+  call->args.gemm_batch.C_im = C_im;
+  call->args.gemm_batch.Row_A = Row_A;
+  call->args.gemm_batch.Col_A = Col_A;
+  call->args.gemm_batch.Col_B = Col_B;
+  call->args.gemm_batch.batch = batch;
+  call->arg_pointers[0] = &call->args.gemm_batch.A_re;
+  call->arg_pointers[1] = &call->args.gemm_batch.A_im;
+  call->arg_pointers[2] = &call->args.gemm_batch.B_re;
+  call->arg_pointers[3] = &call->args.gemm_batch.B_im;
+  call->arg_pointers[4] = &call->args.gemm_batch.C_re;
+  call->arg_pointers[5] = &call->args.gemm_batch.C_im;
+  call->arg_pointers[6] = &call->args.gemm_batch.Row_A;
+  call->arg_pointers[7] = &call->args.gemm_batch.Col_A;
+  call->arg_pointers[8] = &call->args.gemm_batch.Col_B;
+  call->arg_pointers[9] = &call->args.gemm_batch.batch;
+  return dash_graph_link(graph);
+}
+
+void DASH_graph_depend(dash_graph_t graph, size_t node, size_t predecessor) {
+  if (node >= graph->calls.size() || predecessor >= node) {
+    fprintf(stderr, "[libdash] Node %zu of a graph can't depend on node %zu!\n", node, predecessor);
+    exit(1);
+  }
+  dash_graph_edge(graph, predecessor, node);
+}
+
+dash_req_t DASH_graph_submit(dash_graph_t graph) {
+  dash_req_t request = dash_request_alloc();
+#if defined(CPU_ONLY)
+  // Every edge points from an earlier call to a later one, so the calls can simply run in the order they were added
+  for (dash_graph_call& call : graph->calls) {
+    void** args = call.arg_pointers;
+    void (*run_func)(void*, void*, void*, void*, void*, void*, void*, void*, void*, void*, void*, void*, void*, void*, void*);
+    *reinterpret_cast<void**>(&run_func) = dash_kernel_registry[call.kernel_id].run_function;
+    run_func(args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7], args[8], args[9], args[10], args[11],
+             args[12], args[13], args[14]);
+  }
+  dash_completion_signal(&request->completion);
+#else
+  graph->nodes.resize(graph->calls.size());
+  if (graph->waiting_capacity < graph->calls.size()) {
+    graph->waiting.reset(new std::atomic<size_t>[graph->calls.size()]);
+    graph->waiting_capacity = graph->calls.size();
+  }
+  for (size_t i = 0; i < graph->calls.size(); i++) {
+    dash_graph_call& call = graph->calls[i];
+    graph->nodes[i] = dash_graph_node_t{call.kernel_id, call.arg_pointers, call.successors.data(), call.successors.size(),
+                                        call.num_predecessors};
+    graph->waiting[i].store(call.num_predecessors, std::memory_order_relaxed);
+  }
+  enqueue_graph(graph->nodes.data(), graph->waiting.get(), graph->nodes.size(), &request->completion);
+#endif
+  return request;
+}
+/* End of task graph implementations */
+
 #ifdef __cplusplus
 } // Close 'extern "C"'
 #endif
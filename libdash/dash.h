@@ -11,21 +11,37 @@ typedef enum zip_op {
   ZIP_SUB,
   ZIP_MULT,
   ZIP_DIV,
-  ZIP_CMP_MULT
+  ZIP_CMP_MULT,
+  ZIP_FMA,
+  ZIP_SCALE,
+  ZIP_CMP_CONJ_MULT,
+  ZIP_CMP_MAG
 } zip_op_t;
 
 /*
  * Assumes complex input and output of the form input[2*i+0] = real, input[2*i+1] = imaginary
  * "size" specifies the length of the FFT transform, so input and output should be of length 2*size
+ * Any size is supported (not just powers of two), and input may equal output for an in-place transform.
+ * The inverse transform is scaled by 1/size.
  */
 void DASH_FFT(double* input, double* output, size_t size, bool isForwardTransform);
 
 /*
- * ${Comments about usage of DASH_GEMM}
+ * Complex matrix multiply C = A * B on split real/imaginary, row-major matrices:
+ * A is Row_A x Col_A, B is Col_A x Col_B and C is Row_A x Col_B. C must not overlap A or B.
  */
 void DASH_GEMM(double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B);
 
 /*
+ * Element-wise operation over "size" elements. output may be the same buffer as either input.
+ * - ZIP_ADD, ZIP_SUB, ZIP_MULT, ZIP_DIV: output[i] = input_1[i] <op> input_2[i]
+ * - ZIP_FMA: output[i] = input_1[i] * input_2[i] + output[i]
+ * - ZIP_SCALE: output[i] = input_1[i] * input_2[0]
+ * The complex ops work on interleaved (real, imaginary) pairs, so "size" counts complex elements:
+ * - ZIP_CMP_MULT: output = input_1 * input_2
+ * - ZIP_CMP_CONJ_MULT: output = input_1 * conj(input_2)
+ * - ZIP_CMP_MAG: output[i] = |input_1[i]|, a real array of length size (input_2 is not read)
+ *
  * Current open questions: 
  * 1. Should we be doing anything to stop the user from shooting themselves in the foot with divide-by-zero with that ZIP_DIV op?
  */
@@ -36,9 +52,88 @@ void DASH_ZIP(double* input_1, double* input_2, double* output, size_t size, zip
  * Both input and mask should be in double type
  * width and height is for input and output
  * mask_size is for a single dimension of the mask where mask_width=mask_height=mask_size
+ * output[i][j] = sum over k, l of input[i + k - mask_size / 2][j + l - mask_size / 2] * mask[k][l], where taps that
+ * fall outside the image count as zero. output must not alias input.
  */
 void DASH_CONV_2D(double *input, int height, int width, double *mask, int mask_size, double *output);
 
+/*
+ * Batched variants of DASH_FFT and DASH_GEMM for many small problems of the same shape, which are handed to the runtime
+ * as a single kernel call (and may be split across workers) instead of one call per problem.
+ * The problems of a batch are stored back to back: transform b of DASH_FFT_BATCH reads input[2*size*b] to
+ * input[2*size*(b+1) - 1] and writes the same range of output, and product b of DASH_GEMM_BATCH multiplies the b-th
+ * Row_A x Col_A matrix of A by the b-th Col_A x Col_B matrix of B into the b-th Row_A x Col_B matrix of C.
+ * Otherwise each problem follows the rules of DASH_FFT and DASH_GEMM above.
+ */
+void DASH_FFT_BATCH(double* input, double* output, size_t size, size_t batch, bool isForwardTransform);
+void DASH_GEMM_BATCH(double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B, size_t batch);
+
+/*
+ * Asynchronous variants of the kernels above.
+ * Each call returns as soon as the kernel has been handed to the runtime, so several kernels can be kept in flight
+ * from a single application thread. The buffers passed in must stay valid (and unmodified, for inputs) until the
+ * request has completed.
+ *
+ * Every request returned must eventually be passed to DASH_wait or DASH_wait_all, which block until completion and
+ * release the request. DASH_test polls a request without releasing it.
+ * In a CPU_ONLY build the kernel executes before the async call returns and the request is already complete.
+ */
+typedef struct dash_request* dash_req_t;
+
+dash_req_t DASH_FFT_async(double* input, double* output, size_t size, bool isForwardTransform);
+dash_req_t DASH_GEMM_async(double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B);
+dash_req_t DASH_ZIP_async(double* input_1, double* input_2, double* output, size_t size, zip_op_t op);
+dash_req_t DASH_CONV_2D_async(double *input, int height, int width, double *mask, int mask_size, double *output);
+dash_req_t DASH_FFT_BATCH_async(double* input, double* output, size_t size, size_t batch, bool isForwardTransform);
+dash_req_t DASH_GEMM_BATCH_async(double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B, size_t batch);
+
+// Returns nonzero if the request has completed
+int DASH_test(dash_req_t request);
+void DASH_wait(dash_req_t request);
+void DASH_wait_all(dash_req_t* requests, size_t count);
+
+/*
+ * Task graphs.
+ * A graph records a series of kernel calls that is submitted to the runtime at once. The runtime starts each call as
+ * soon as the calls it depends on have completed, without a round trip through the application, and the request
+ * returned by DASH_graph_submit completes once every call in the graph has.
+ *
+ * Dependencies follow from the buffers: a call depends on every earlier call of the graph whose buffers overlap its
+ * own, where at least one of the two writes the overlapping memory. DASH_graph_depend adds an ordering the buffers
+ * don't show. Each DASH_graph_<kernel> call returns the index of the new node (0 for the first, and so on).
+ *
+ * Buffers must stay valid until the graph's request has completed, and a graph must not be changed, resubmitted or
+ * destroyed while it is in flight. A completed graph may be submitted again.
+ */
+typedef struct dash_graph* dash_graph_t;
+
+dash_graph_t DASH_graph_create(void);
+void DASH_graph_destroy(dash_graph_t graph);
+
+size_t DASH_graph_FFT(dash_graph_t graph, double* input, double* output, size_t size, bool isForwardTransform);
+size_t DASH_graph_GEMM(dash_graph_t graph, double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B);
+size_t DASH_graph_ZIP(dash_graph_t graph, double* input_1, double* input_2, double* output, size_t size, zip_op_t op);
+size_t DASH_graph_CONV_2D(dash_graph_t graph, double *input, int height, int width, double *mask, int mask_size, double *output);
+size_t DASH_graph_FFT_BATCH(dash_graph_t graph, double* input, double* output, size_t size, size_t batch, bool isForwardTransform);
+size_t DASH_graph_GEMM_BATCH(dash_graph_t graph, double* A_re, double* A_im, double* B_re, double* B_im, double* C_re, double* C_im, size_t Row_A, size_t Col_A, size_t Col_B, size_t batch);
+
+// Makes node wait for predecessor, which must have been added to the graph before it
+void DASH_graph_depend(dash_graph_t graph, size_t node, size_t predecessor);
+dash_req_t DASH_graph_submit(dash_graph_t graph);
+
+/*
+ * Buffer allocation.
+ * DASH_alloc returns a buffer of at least "bytes" bytes aligned to 64 bytes, or NULL if no memory is left. Buffers come
+ * from size-class pools, so allocating and freeing them in a loop doesn't go back to the OS, and the runtime hands
+ * them to (emulated) accelerators in place, where other memory has to be staged first. DASH_free only accepts buffers
+ * returned by DASH_alloc (or NULL).
+ *
+ * Setting DASH_ALLOC_HUGE_PAGES=1 backs the pools with transparent huge pages, and DASH_ALLOC_NUMA=local keeps a pool
+ * per NUMA node, placing buffers on the node of the thread that allocates them.
+ */
+void* DASH_alloc(size_t bytes);
+void DASH_free(void* buffer);
+
 #ifdef __cplusplus
 } // Close 'extern "C"'
 #endif
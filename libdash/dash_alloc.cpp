@@ -0,0 +1,237 @@
+#include "dash.h"
+#include "dash_kernels.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Pooled buffer allocator behind DASH_alloc and DASH_free.
+ *
+ * Requests are rounded up to a size class: multiples of 64 bytes up to 256 bytes, then four classes per power of two,
+ * so no more than a fifth of a buffer is padding. Buffers of a class are carved out of chunks, which are mapped from
+ * the OS in multiples of 2 MiB and aligned to 2 MiB so that they can be backed by huge pages. Every chunk is
+ * registered under each 2 MiB window of the address space it covers, which lets any pointer into a buffer be traced
+ * back to the buffer in a couple of probes of a lock-free table. Freed buffers go back to their class's free list and
+ * are reused; memory is never returned to the OS.
+ *
+ * With DASH_ALLOC_NUMA=local, every NUMA node has its own free lists and chunks are placed on the node of the thread
+ * that maps them. With DASH_ALLOC_HUGE_PAGES=1, chunks are marked for transparent huge pages.
+ */
+#define DASH_ALLOC_ALIGNMENT 64
+#define DASH_ALLOC_CHUNK_SIZE ((size_t) 2 << 20)
+// Number of 2 MiB windows the chunk table can register, i.e. 128 GiB of buffers
+#define DASH_ALLOC_TABLE_SIZE (1 << 16)
+#define DASH_ALLOC_CLASSES 168
+#define DASH_ALLOC_MAX_NODES 8
+#define DASH_ALLOC_NUMA_ENV_VAR "DASH_ALLOC_NUMA"
+#define DASH_ALLOC_HUGE_PAGES_ENV_VAR "DASH_ALLOC_HUGE_PAGES"
+// From <numaif.h>, which would pull in libnuma just for this
+#define DASH_MPOL_PREFERRED 1
+
+struct dash_chunk {
+  char* base;
+  size_t length;
+  size_t block_size;
+  unsigned node;
+  unsigned size_class;
+};
+
+struct dash_free_list {
+  pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  std::vector<void*> blocks;
+};
+
+struct dash_allocator {
+  bool numa_local;
+  bool huge_pages;
+  dash_free_list free_lists[DASH_ALLOC_MAX_NODES][DASH_ALLOC_CLASSES];
+  // Open-addressed, insert-only map from 2 MiB window number (plus one, so that 0 marks a free slot) to chunk
+  std::atomic<uintptr_t> windows[DASH_ALLOC_TABLE_SIZE];
+  std::atomic<dash_chunk*> chunks[DASH_ALLOC_TABLE_SIZE];
+
+  dash_allocator() {
+    const char* numa = getenv(DASH_ALLOC_NUMA_ENV_VAR);
+    const char* huge = getenv(DASH_ALLOC_HUGE_PAGES_ENV_VAR);
+    numa_local = (numa != nullptr && strcmp(numa, "local") == 0);
+    huge_pages = (huge != nullptr && strcmp(huge, "1") == 0);
+    for (size_t i = 0; i < DASH_ALLOC_TABLE_SIZE; i++) {
+      windows[i].store(0, std::memory_order_relaxed);
+      chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+};
+
+// Created on first use, and deliberately never destroyed: buffers may be freed from static destructors
+static dash_allocator* dash_allocator_get() {
+  static dash_allocator* allocator = new dash_allocator();
+  return allocator;
+}
+
+// Size class of a request, and the size of that class's buffers
+static unsigned dash_alloc_class(size_t bytes, size_t* class_size) {
+  if (bytes <= 256) {
+    size_t steps = (bytes + DASH_ALLOC_ALIGNMENT - 1) / DASH_ALLOC_ALIGNMENT;
+    steps = steps > 0 ? steps : 1;
+    *class_size = steps * DASH_ALLOC_ALIGNMENT;
+    return (unsigned) steps - 1;
+  }
+  unsigned log2 = 63 - __builtin_clzll(bytes - 1);
+  size_t base = (size_t) 1 << log2;
+  size_t step = base / 4;
+  size_t steps = (bytes - base + step - 1) / step;
+  *class_size = base + steps * step;
+  return 3 + (log2 - 8) * 4 + (unsigned) steps;
+}
+
+static size_t dash_window_slot(uintptr_t key) {
+  return (size_t) ((key * 0x9E3779B97F4A7C15ull) >> 48) & (DASH_ALLOC_TABLE_SIZE - 1);
+}
+
+static bool dash_register_chunk(dash_allocator* allocator, dash_chunk* chunk) {
+  for (uintptr_t window = (uintptr_t) chunk->base / DASH_ALLOC_CHUNK_SIZE;
+       window < (uintptr_t) (chunk->base + chunk->length) / DASH_ALLOC_CHUNK_SIZE; window++) {
+    uintptr_t key = window + 1;
+    size_t slot = dash_window_slot(key);
+    size_t probes = 0;
+    while (true) {
+      uintptr_t expected = 0;
+      if (allocator->windows[slot].compare_exchange_strong(expected, key, std::memory_order_acq_rel)) {
+        allocator->chunks[slot].store(chunk, std::memory_order_release);
+        break;
+      }
+      if (++probes == DASH_ALLOC_TABLE_SIZE) {
+        return false;
+      }
+      slot = (slot + 1) & (DASH_ALLOC_TABLE_SIZE - 1);
+    }
+  }
+  return true;
+}
+
+static dash_chunk* dash_find_chunk(const void* pointer) {
+  dash_allocator* allocator = dash_allocator_get();
+  uintptr_t key = (uintptr_t) pointer / DASH_ALLOC_CHUNK_SIZE + 1;
+  size_t slot = dash_window_slot(key);
+  for (size_t probes = 0; probes < DASH_ALLOC_TABLE_SIZE; probes++) {
+    uintptr_t found = allocator->windows[slot].load(std::memory_order_acquire);
+    if (found == key) {
+      return allocator->chunks[slot].load(std::memory_order_acquire);
+    }
+    if (found == 0) {
+      return nullptr;
+    }
+    slot = (slot + 1) & (DASH_ALLOC_TABLE_SIZE - 1);
+  }
+  return nullptr;
+}
+
+static unsigned dash_current_node(dash_allocator* allocator) {
+  unsigned cpu = 0, node = 0;
+  if (allocator->numa_local && syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return node % DASH_ALLOC_MAX_NODES;
+  }
+  return 0;
+}
+
+// Maps a 2 MiB-aligned chunk of length bytes, placed on the given NUMA node if the allocator is NUMA-local
+static char* dash_map_chunk(dash_allocator* allocator, size_t length, unsigned node) {
+  size_t mapped = length + DASH_ALLOC_CHUNK_SIZE;
+  char* memory = (char*) mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return nullptr;
+  }
+  char* base = (char*) (((uintptr_t) memory + DASH_ALLOC_CHUNK_SIZE - 1) & ~(uintptr_t) (DASH_ALLOC_CHUNK_SIZE - 1));
+  if (base > memory) {
+    munmap(memory, base - memory);
+  }
+  if (memory + mapped > base + length) {
+    munmap(base + length, memory + mapped - (base + length));
+  }
+#ifdef MADV_HUGEPAGE
+  if (allocator->huge_pages) {
+    madvise(base, length, MADV_HUGEPAGE);
+  }
+#endif
+  if (allocator->numa_local) {
+    unsigned long node_mask = 1ul << node;
+    syscall(SYS_mbind, base, length, DASH_MPOL_PREFERRED, &node_mask, sizeof(node_mask) * 8, 0);
+  }
+  return base;
+}
+
+// Adds a new chunk's buffers to a free list; called with the list's mutex held
+static bool dash_refill(dash_allocator* allocator, dash_free_list* list, unsigned node, unsigned size_class,
+                        size_t block_size) {
+  size_t blocks = (block_size >= DASH_ALLOC_CHUNK_SIZE) ? 1 : DASH_ALLOC_CHUNK_SIZE / block_size;
+  size_t length = (block_size * blocks + DASH_ALLOC_CHUNK_SIZE - 1) / DASH_ALLOC_CHUNK_SIZE * DASH_ALLOC_CHUNK_SIZE;
+  char* base = dash_map_chunk(allocator, length, node);
+  if (base == nullptr) {
+    return false;
+  }
+  dash_chunk* chunk = new dash_chunk{base, length, block_size, node, size_class};
+  if (!dash_register_chunk(allocator, chunk)) {
+    fprintf(stderr, "[libdash] The DASH_alloc chunk table is full!\n");
+    return false;
+  }
+  // Lowest addresses are handed out first
+  for (size_t b = blocks; b > 0; b--) {
+    list->blocks.push_back(base + (b - 1) * block_size);
+  }
+  return true;
+}
+
+void* DASH_alloc(size_t bytes) {
+  dash_allocator* allocator = dash_allocator_get();
+  size_t block_size;
+  unsigned size_class = dash_alloc_class(bytes, &block_size);
+  if (size_class >= DASH_ALLOC_CLASSES) {
+    return nullptr;
+  }
+  unsigned node = dash_current_node(allocator);
+  dash_free_list* list = &allocator->free_lists[node][size_class];
+  void* buffer = nullptr;
+  pthread_mutex_lock(&list->mutex);
+  if (!list->blocks.empty() || dash_refill(allocator, list, node, size_class, block_size)) {
+    buffer = list->blocks.back();
+    list->blocks.pop_back();
+  }
+  pthread_mutex_unlock(&list->mutex);
+  return buffer;
+}
+
+void DASH_free(void* buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+  dash_chunk* chunk = dash_find_chunk(buffer);
+  if (chunk == nullptr || ((char*) buffer - chunk->base) % chunk->block_size != 0) {
+    fprintf(stderr, "[libdash] DASH_free was passed %p, which DASH_alloc didn't return!\n", buffer);
+    exit(1);
+  }
+  dash_free_list* list = &dash_allocator_get()->free_lists[chunk->node][chunk->size_class];
+  pthread_mutex_lock(&list->mutex);
+  list->blocks.push_back(buffer);
+  pthread_mutex_unlock(&list->mutex);
+}
+
+int dash_buffer_find(const void* pointer, void** base, size_t* size) {
+  dash_chunk* chunk = dash_find_chunk(pointer);
+  if (chunk == nullptr || (const char*) pointer < chunk->base || (const char*) pointer >= chunk->base + chunk->length) {
+    return 0;
+  }
+  size_t block = ((const char*) pointer - chunk->base) / chunk->block_size;
+  if (base != nullptr) {
+    *base = chunk->base + block * chunk->block_size;
+  }
+  if (size != nullptr) {
+    *size = chunk->block_size;
+  }
+  return 1;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * One-shot completion flag used to hand a finished kernel back to the thread that enqueued it.
+ *
+ * The runtime worker that executes the kernel calls dash_completion_signal and immediately moves on to its next task,
+ * while the application thread waits in dash_completion_wait: it spins for a short while (most small kernels finish
+ * within that window) and then sleeps on a futex. The futex is only woken if a waiter actually went to sleep.
+ */
+
+#define DASH_COMPLETION_PENDING 0u
+#define DASH_COMPLETION_DONE 1u
+#define DASH_COMPLETION_SLEEPING 2u
+
+// Number of polls a waiter performs before it sleeps on the futex
+#define DASH_COMPLETION_SPIN_ITERATIONS 2048
+
+typedef struct dash_completion {
+  std::atomic<uint32_t> state;
+} dash_completion_t;
+
+static inline long dash_futex(std::atomic<uint32_t>* addr, int op, uint32_t val) {
+  return syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), op | FUTEX_PRIVATE_FLAG, val, nullptr, nullptr, 0);
+}
+
+static inline void dash_completion_init(dash_completion_t* completion) {
+  completion->state.store(DASH_COMPLETION_PENDING, std::memory_order_relaxed);
+}
+
+static inline bool dash_completion_test(dash_completion_t* completion) {
+  return completion->state.load(std::memory_order_acquire) == DASH_COMPLETION_DONE;
+}
+
+static inline void dash_completion_signal(dash_completion_t* completion) {
+  if (completion->state.exchange(DASH_COMPLETION_DONE, std::memory_order_acq_rel) == DASH_COMPLETION_SLEEPING) {
+    dash_futex(&completion->state, FUTEX_WAKE, INT_MAX);
+  }
+}
+
+static inline void dash_completion_wait(dash_completion_t* completion) {
+  // Spinning only helps when the signalling worker can run concurrently on another core
+  static const int spin_iterations = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? DASH_COMPLETION_SPIN_ITERATIONS : 0;
+  for (int i = 0; i < spin_iterations; i++) {
+    if (dash_completion_test(completion)) {
+      return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  uint32_t expected = DASH_COMPLETION_PENDING;
+  completion->state.compare_exchange_strong(expected, DASH_COMPLETION_SLEEPING, std::memory_order_acq_rel);
+  while (completion->state.load(std::memory_order_acquire) != DASH_COMPLETION_DONE) {
+    dash_futex(&completion->state, FUTEX_WAIT, DASH_COMPLETION_SLEEPING);
+  }
+}
@@ -0,0 +1,414 @@
+#include "dash.h"
+#include "dash_isa.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * 2D convolution with zero padding: output[i][j] = sum over k, l of input[i + k - z][j + l - z] * mask[k][l],
+ * where z = mask_size / 2 and taps that fall outside the image contribute nothing.
+ *
+ * Every output row only visits the mask rows that land inside the image, so the bounds checks are hoisted out of the
+ * inner loops except for the few border columns. The interior of each row is computed by a vectorized kernel that keeps
+ * a tile of output columns in registers while it walks all the taps (AVX-512 or AVX2+FMA, selected once at runtime or
+ * forced with DASH_CONV_ISA=<avx512|avx2|scalar>). Rank-1 masks (e.g. Gaussian or box filters) are detected and
+ * applied as a horizontal followed by a vertical 1D pass. Other masks of at least DASH_CONV_FFT_MASK_SIZE taps per
+ * side are applied in the frequency domain using DASH_FFT_cpu.
+ */
+
+// Default smallest mask side length that is convolved through the FFT, overridable through the environment variable
+#define CONV_FFT_MASK_SIZE 41
+#define CONV_FFT_MASK_SIZE_ENV_VAR "DASH_CONV_FFT_MASK_SIZE"
+// A mask is treated as rank-1 if its outer-product reconstruction is this close, relative to its largest tap
+#define CONV_RANK1_TOLERANCE 1e-12
+#define CONV_TRANSPOSE_BLOCK 32
+
+extern "C" void DASH_FFT_cpu(double** input, double** output, size_t* size, bool* isForwardTransform);
+extern "C" void DASH_ZIP_cpu(double** input_1, double** input_2, double** output, size_t* size, zip_op_t* op);
+
+/*
+ * Computes out[j] = sum over r < nrows and t < ntaps of taps[r * tap_stride + t] * rows[r][j + t] for j < n.
+ * Every convolution pass below is expressed in terms of this kernel.
+ */
+typedef void (*conv_rows_fn)(const double* const* rows, size_t nrows, const double* taps, size_t ntaps,
+                             size_t tap_stride, double* out, size_t n);
+
+static inline double conv_point(const double* const* rows, size_t nrows, const double* taps, size_t ntaps,
+                                size_t tap_stride, size_t j) {
+  double acc = 0;
+  for (size_t r = 0; r < nrows; r++) {
+    const double* src = rows[r] + j;
+    const double* t = taps + r * tap_stride;
+    for (size_t tt = 0; tt < ntaps; tt++) {
+      acc += t[tt] * src[tt];
+    }
+  }
+  return acc;
+}
+
+static void conv_rows_scalar(const double* const* rows, size_t nrows, const double* taps, size_t ntaps,
+                             size_t tap_stride, double* out, size_t n) {
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4) {
+    double acc[4] = {};
+    for (size_t r = 0; r < nrows; r++) {
+      const double* src = rows[r] + j;
+      const double* t = taps + r * tap_stride;
+      for (size_t tt = 0; tt < ntaps; tt++) {
+        for (size_t jj = 0; jj < 4; jj++) {
+          acc[jj] += t[tt] * src[tt + jj];
+        }
+      }
+    }
+    for (size_t jj = 0; jj < 4; jj++) {
+      out[j + jj] = acc[jj];
+    }
+  }
+  for (; j < n; j++) {
+    out[j] = conv_point(rows, nrows, taps, ntaps, tap_stride, j);
+  }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+static void conv_rows_avx2(const double* const* rows, size_t nrows, const double* taps, size_t ntaps,
+                           size_t tap_stride, double* out, size_t n) {
+  size_t j = 0;
+  for (; j + 16 <= n; j += 16) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    for (size_t r = 0; r < nrows; r++) {
+      const double* src = rows[r] + j;
+      const double* t = taps + r * tap_stride;
+      for (size_t tt = 0; tt < ntaps; tt++) {
+        __m256d m = _mm256_broadcast_sd(t + tt);
+        acc0 = _mm256_fmadd_pd(m, _mm256_loadu_pd(src + tt), acc0);
+        acc1 = _mm256_fmadd_pd(m, _mm256_loadu_pd(src + tt + 4), acc1);
+        acc2 = _mm256_fmadd_pd(m, _mm256_loadu_pd(src + tt + 8), acc2);
+        acc3 = _mm256_fmadd_pd(m, _mm256_loadu_pd(src + tt + 12), acc3);
+      }
+    }
+    _mm256_storeu_pd(out + j, acc0);
+    _mm256_storeu_pd(out + j + 4, acc1);
+    _mm256_storeu_pd(out + j + 8, acc2);
+    _mm256_storeu_pd(out + j + 12, acc3);
+  }
+  for (; j + 4 <= n; j += 4) {
+    __m256d acc = _mm256_setzero_pd();
+    for (size_t r = 0; r < nrows; r++) {
+      const double* src = rows[r] + j;
+      const double* t = taps + r * tap_stride;
+      for (size_t tt = 0; tt < ntaps; tt++) {
+        acc = _mm256_fmadd_pd(_mm256_broadcast_sd(t + tt), _mm256_loadu_pd(src + tt), acc);
+      }
+    }
+    _mm256_storeu_pd(out + j, acc);
+  }
+  for (; j < n; j++) {
+    out[j] = conv_point(rows, nrows, taps, ntaps, tap_stride, j);
+  }
+}
+
+__attribute__((target("avx512f")))
+static void conv_rows_avx512(const double* const* rows, size_t nrows, const double* taps, size_t ntaps,
+                             size_t tap_stride, double* out, size_t n) {
+  size_t j = 0;
+  for (; j + 32 <= n; j += 32) {
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    __m512d acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+    for (size_t r = 0; r < nrows; r++) {
+      const double* src = rows[r] + j;
+      const double* t = taps + r * tap_stride;
+      for (size_t tt = 0; tt < ntaps; tt++) {
+        __m512d m = _mm512_set1_pd(t[tt]);
+        acc0 = _mm512_fmadd_pd(m, _mm512_loadu_pd(src + tt), acc0);
+        acc1 = _mm512_fmadd_pd(m, _mm512_loadu_pd(src + tt + 8), acc1);
+        acc2 = _mm512_fmadd_pd(m, _mm512_loadu_pd(src + tt + 16), acc2);
+        acc3 = _mm512_fmadd_pd(m, _mm512_loadu_pd(src + tt + 24), acc3);
+      }
+    }
+    _mm512_storeu_pd(out + j, acc0);
+    _mm512_storeu_pd(out + j + 8, acc1);
+    _mm512_storeu_pd(out + j + 16, acc2);
+    _mm512_storeu_pd(out + j + 24, acc3);
+  }
+  for (; j + 8 <= n; j += 8) {
+    __m512d acc = _mm512_setzero_pd();
+    for (size_t r = 0; r < nrows; r++) {
+      const double* src = rows[r] + j;
+      const double* t = taps + r * tap_stride;
+      for (size_t tt = 0; tt < ntaps; tt++) {
+        acc = _mm512_fmadd_pd(_mm512_set1_pd(t[tt]), _mm512_loadu_pd(src + tt), acc);
+      }
+    }
+    _mm512_storeu_pd(out + j, acc);
+  }
+  for (; j < n; j++) {
+    out[j] = conv_point(rows, nrows, taps, ntaps, tap_stride, j);
+  }
+}
+#endif
+
+static conv_rows_fn conv_select_kernel() {
+  switch (dash_select_isa("DASH_CONV_ISA")) {
+#if defined(__x86_64__)
+    case DASH_ISA_AVX512:
+      return conv_rows_avx512;
+    case DASH_ISA_AVX2:
+      return conv_rows_avx2;
+#endif
+    default:
+      return conv_rows_scalar;
+  }
+}
+
+static conv_rows_fn conv_active_kernel() {
+  static const conv_rows_fn kernel = conv_select_kernel();
+  return kernel;
+}
+
+static size_t conv_fft_mask_size() {
+  static const size_t mask_size = []() {
+    const char* requested = getenv(CONV_FFT_MASK_SIZE_ENV_VAR);
+    int size = (requested != nullptr) ? atoi(requested) : CONV_FFT_MASK_SIZE;
+    return (size_t) (size > 0 ? size : CONV_FFT_MASK_SIZE);
+  }();
+  return mask_size;
+}
+
+// Scratch comes from the DASH_alloc pools, so repeated calls reuse the same aligned buffers
+static void* conv_alloc(size_t bytes) {
+  void* memory = DASH_alloc(bytes);
+  if (memory == nullptr) {
+    fprintf(stderr, "[libdash] Failed to allocate %zu bytes of DASH_CONV_2D scratch memory!\n", bytes);
+    exit(1);
+  }
+  return memory;
+}
+
+/*
+ * Direct convolution of a height x width image with a kh x kw mask whose tap (ch, cw) sits over the output pixel,
+ * computing output rows [row_begin, row_end) only. Output must not alias input.
+ */
+static void conv_direct(const double* input, size_t height, size_t width, const double* mask, size_t kh, size_t kw,
+                        size_t ch, size_t cw, double* output, size_t row_begin, size_t row_end) {
+  conv_rows_fn kernel = conv_active_kernel();
+  const double** rows = (const double**) conv_alloc(kh * sizeof(double*));
+  // Columns [left, right) have every horizontal tap inside the image
+  size_t left = (cw < width) ? cw : width;
+  size_t right = (width + cw >= kw - 1 && width + cw - (kw - 1) > left) ? width + cw - (kw - 1) : left;
+
+  for (size_t i = row_begin; i < row_end; i++) {
+    // Mask rows [k0, k1) land inside the image for this output row
+    size_t k0 = (i < ch) ? ch - i : 0;
+    size_t k1 = (height - i + ch < kh) ? height - i + ch : kh;
+    double* out = output + i * width;
+    if (k0 >= k1) {
+      memset(out, 0, width * sizeof(double));
+      continue;
+    }
+    for (size_t k = k0; k < k1; k++) {
+      rows[k - k0] = input + (i + k - ch) * width;
+    }
+
+    if (right > left) {
+      // Here left == cw, so out[left + j] needs rows[.][j + l] for every tap l
+      kernel(rows, k1 - k0, mask + k0 * kw, kw, kw, out + left, right - left);
+    }
+
+    for (size_t j = 0; j < width; j++) {
+      if (j == left && right > left) {
+        j = right - 1;
+        continue;
+      }
+      double acc = 0;
+      for (size_t k = k0; k < k1; k++) {
+        const double* src = rows[k - k0];
+        for (size_t l = 0; l < kw; l++) {
+          if (j + l >= cw && j + l - cw < width) {
+            acc += src[j + l - cw] * mask[k * kw + l];
+          }
+        }
+      }
+      out[j] = acc;
+    }
+  }
+  DASH_free(rows);
+}
+
+/*
+ * Checks whether mask = column * row^T (up to rounding) and if so fills in both factors.
+ */
+static bool conv_factor_rank1(const double* mask, size_t mask_size, double* column, double* row) {
+  size_t pivot = 0;
+  for (size_t i = 1; i < mask_size * mask_size; i++) {
+    if (fabs(mask[i]) > fabs(mask[pivot])) {
+      pivot = i;
+    }
+  }
+  double largest = fabs(mask[pivot]);
+  size_t pivot_row = pivot / mask_size, pivot_col = pivot % mask_size;
+  for (size_t k = 0; k < mask_size; k++) {
+    column[k] = mask[k * mask_size + pivot_col];
+    row[k] = (largest > 0) ? mask[pivot_row * mask_size + k] / mask[pivot] : 0.0;
+  }
+  for (size_t k = 0; k < mask_size; k++) {
+    for (size_t l = 0; l < mask_size; l++) {
+      if (fabs(mask[k * mask_size + l] - column[k] * row[l]) > CONV_RANK1_TOLERANCE * largest) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Smallest n' >= n whose only prime factors are 2, 3, 5 and 7, which GSL transforms efficiently
+static size_t conv_fft_size(size_t n) {
+  static const size_t factors[] = {2, 3, 5, 7};
+  for (;; n++) {
+    size_t rest = n;
+    for (size_t f = 0; f < sizeof(factors) / sizeof(factors[0]); f++) {
+      while (rest % factors[f] == 0) {
+        rest /= factors[f];
+      }
+    }
+    if (rest == 1) {
+      return n;
+    }
+  }
+}
+
+// Transposes a rows x cols matrix of interleaved complex numbers
+static void conv_transpose(const double* in, size_t rows, size_t cols, double* out) {
+  for (size_t i0 = 0; i0 < rows; i0 += CONV_TRANSPOSE_BLOCK) {
+    for (size_t j0 = 0; j0 < cols; j0 += CONV_TRANSPOSE_BLOCK) {
+      size_t i1 = (i0 + CONV_TRANSPOSE_BLOCK < rows) ? i0 + CONV_TRANSPOSE_BLOCK : rows;
+      size_t j1 = (j0 + CONV_TRANSPOSE_BLOCK < cols) ? j0 + CONV_TRANSPOSE_BLOCK : cols;
+      for (size_t i = i0; i < i1; i++) {
+        for (size_t j = j0; j < j1; j++) {
+          out[2 * (j * rows + i)] = in[2 * (i * cols + j)];
+          out[2 * (j * rows + i) + 1] = in[2 * (i * cols + j) + 1];
+        }
+      }
+    }
+  }
+}
+
+static void conv_fft_rows(double* data, size_t rows, size_t cols, bool forward) {
+  for (size_t i = 0; i < rows; i++) {
+    double* row = data + 2 * i * cols;
+    DASH_FFT_cpu(&row, &row, &cols, &forward);
+  }
+}
+
+/*
+ * Convolution as a pointwise product of 2D spectra. Both operands are zero-padded to at least
+ * (height + mask_size - 1) x (width + mask_size - 1) so the circular convolution equals the linear one, and the
+ * mask is flipped since DASH_CONV_2D correlates. The 2D transforms are row transforms, a transpose and row transforms
+ * again; the spectra are multiplied in their transposed layout. Only output rows [row_begin, row_end) are written.
+ */
+static void conv_fft(const double* input, size_t height, size_t width, const double* mask, size_t mask_size,
+                     double* output, size_t row_begin, size_t row_end) {
+  size_t p = conv_fft_size(height + mask_size - 1);
+  size_t q = conv_fft_size(width + mask_size - 1);
+  size_t bytes = 2 * p * q * sizeof(double);
+  double* image = (double*) conv_alloc(bytes);
+  double* kernel = (double*) conv_alloc(bytes);
+  double* transposed = (double*) conv_alloc(bytes);
+
+  memset(image, 0, bytes);
+  memset(kernel, 0, bytes);
+  for (size_t i = 0; i < height; i++) {
+    for (size_t j = 0; j < width; j++) {
+      image[2 * (i * q + j)] = input[i * width + j];
+    }
+  }
+  for (size_t k = 0; k < mask_size; k++) {
+    for (size_t l = 0; l < mask_size; l++) {
+      kernel[2 * (k * q + l)] = mask[(mask_size - 1 - k) * mask_size + (mask_size - 1 - l)];
+    }
+  }
+
+  // Forward transforms: the image spectrum ends up (transposed) in "transposed", the mask's in "image"
+  conv_fft_rows(image, p, q, true);
+  conv_transpose(image, p, q, transposed);
+  conv_fft_rows(transposed, q, p, true);
+  conv_fft_rows(kernel, p, q, true);
+  conv_transpose(kernel, p, q, image);
+  conv_fft_rows(image, q, p, true);
+
+  size_t elements = p * q;
+  zip_op_t op = ZIP_CMP_MULT;
+  DASH_ZIP_cpu(&transposed, &image, &transposed, &elements, &op);
+
+  conv_fft_rows(transposed, q, p, false);
+  conv_transpose(transposed, q, p, kernel);
+  conv_fft_rows(kernel, p, q, false);
+
+  // Full convolution index n corresponds to output index n - (mask_size - 1 - z)
+  size_t offset = mask_size - 1 - mask_size / 2;
+  for (size_t i = row_begin; i < row_end; i++) {
+    for (size_t j = 0; j < width; j++) {
+      output[i * width + j] = kernel[2 * ((i + offset) * q + j + offset)];
+    }
+  }
+
+  DASH_free(image);
+  DASH_free(kernel);
+  DASH_free(transposed);
+}
+
+/*
+ * Computes rows [row_begin, row_end) of the convolution. The separable and FFT paths only process the input rows
+ * those output rows depend on, i.e. the band extended by a halo of mask rows above and below, so that bands of one
+ * image can be computed independently.
+ */
+static void conv_2d_rows(const double* input, size_t h, size_t w, const double* mask, size_t m, double* output,
+                         size_t row_begin, size_t row_end) {
+  if (m == 0) {
+    memset(output + row_begin * w, 0, (row_end - row_begin) * w * sizeof(double));
+    return;
+  }
+  size_t z = m / 2;
+  // Input rows [halo_begin, halo_end) contribute to the band
+  size_t halo_begin = (row_begin > z) ? row_begin - z : 0;
+  size_t halo_end = (row_end + (m - 1 - z) < h) ? row_end + (m - 1 - z) : h;
+  const double* band_input = input + halo_begin * w;
+  double* band_output = output + halo_begin * w;
+  size_t band_height = halo_end - halo_begin;
+
+  double* column = (double*) conv_alloc(2 * m * sizeof(double));
+  double* row = column + m;
+  if (m > 1 && conv_factor_rank1(mask, m, column, row)) {
+    // Horizontal pass with the row factor, then vertical pass with the column factor
+    double* horizontal = (double*) conv_alloc(band_height * w * sizeof(double));
+    conv_direct(band_input, band_height, w, row, 1, m, 0, z, horizontal, 0, band_height);
+    conv_direct(horizontal, band_height, w, column, m, 1, z, 0, band_output, row_begin - halo_begin, row_end - halo_begin);
+    DASH_free(horizontal);
+  } else if (m >= conv_fft_mask_size()) {
+    conv_fft(band_input, band_height, w, mask, m, band_output, row_begin - halo_begin, row_end - halo_begin);
+  } else {
+    conv_direct(input, h, w, mask, m, m, z, z, output, row_begin, row_end);
+  }
+  DASH_free(column);
+}
+
+extern "C" void DASH_CONV_2D_cpu(double** input, int* height, int* width, double** mask, int* mask_size, double** output) {
+  if (*height <= 0 || *width <= 0) {
+    return;
+  }
+  conv_2d_rows(*input, *height, *width, *mask, (*mask_size > 0) ? *mask_size : 0, *output, 0, *height);
+}
+
+// Rows [row_begin, row_end) of DASH_CONV_2D_cpu, used by the runtime to split large convolutions into row bands
+extern "C" void DASH_CONV_2D_rows_cpu(double** input, int* height, int* width, double** mask, int* mask_size,
+                                      double** output, int* row_begin, int* row_end) {
+  if (*height <= 0 || *width <= 0 || *row_begin >= *row_end) {
+    return;
+  }
+  conv_2d_rows(*input, *height, *width, *mask, (*mask_size > 0) ? *mask_size : 0, *output, *row_begin, *row_end);
+}
@@ -0,0 +1,342 @@
+#include "dash.h"
+#include "dash_isa.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Split-complex GEMM: C = A * B with A (A_ROWS x A_COLS), B (A_COLS x B_COLS) and C (A_ROWS x B_COLS), all row-major
+ * and stored as separate real and imaginary arrays. C must not alias A or B.
+ *
+ * Large products follow the usual packed/blocked scheme: a KC x NC panel of B and an MC x KC block of A are packed
+ * into contiguous, zero-padded strips so that an MR x NR microkernel can stream through both with unit stride while
+ * its accumulators stay in registers. The microkernel is picked once at runtime from the instruction sets the CPU
+ * supports (AVX-512, AVX2+FMA or portable scalar code), and can be forced with DASH_GEMM_ISA=<avx512|avx2|scalar>.
+ * Setting DASH_GEMM_THREADS=<n> additionally splits the rows of C across n threads.
+ */
+
+#define GEMM_MC 64
+#define GEMM_KC 256
+#define GEMM_NC 512
+#define GEMM_MAX_MR 4
+#define GEMM_MAX_NR 8
+// Products with fewer multiply-adds than this skip packing and use the simple row-streaming loop
+#define GEMM_SMALL_WORK (48 * 48 * 48)
+
+typedef void (*gemm_microkernel_fn)(size_t kc, const double* a_re, const double* a_im, const double* b_re,
+                                    const double* b_im, double* c_re, double* c_im, size_t ldc, bool accumulate);
+
+struct gemm_isa {
+  const char* name;
+  size_t mr;
+  size_t nr;
+  gemm_microkernel_fn microkernel;
+};
+
+static void gemm_microkernel_scalar(size_t kc, const double* a_re, const double* a_im, const double* b_re,
+                                    const double* b_im, double* c_re, double* c_im, size_t ldc, bool accumulate) {
+  double acc_re[4][4] = {};
+  double acc_im[4][4] = {};
+  for (size_t k = 0; k < kc; k++) {
+    for (size_t i = 0; i < 4; i++) {
+      double ar = a_re[k * 4 + i];
+      double ai = a_im[k * 4 + i];
+      for (size_t j = 0; j < 4; j++) {
+        double br = b_re[k * 4 + j];
+        double bi = b_im[k * 4 + j];
+        acc_re[i][j] += ar * br - ai * bi;
+        acc_im[i][j] += ar * bi + ai * br;
+      }
+    }
+  }
+  for (size_t i = 0; i < 4; i++) {
+    for (size_t j = 0; j < 4; j++) {
+      if (accumulate) {
+        c_re[i * ldc + j] += acc_re[i][j];
+        c_im[i * ldc + j] += acc_im[i][j];
+      } else {
+        c_re[i * ldc + j] = acc_re[i][j];
+        c_im[i * ldc + j] = acc_im[i][j];
+      }
+    }
+  }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma")))
+static void gemm_microkernel_avx2(size_t kc, const double* a_re, const double* a_im, const double* b_re,
+                                  const double* b_im, double* c_re, double* c_im, size_t ldc, bool accumulate) {
+  __m256d acc_re[4], acc_im[4];
+  for (int i = 0; i < 4; i++) {
+    acc_re[i] = _mm256_setzero_pd();
+    acc_im[i] = _mm256_setzero_pd();
+  }
+  for (size_t k = 0; k < kc; k++) {
+    __m256d br = _mm256_loadu_pd(b_re + k * 4);
+    __m256d bi = _mm256_loadu_pd(b_im + k * 4);
+    for (int i = 0; i < 4; i++) {
+      __m256d ar = _mm256_broadcast_sd(a_re + k * 4 + i);
+      __m256d ai = _mm256_broadcast_sd(a_im + k * 4 + i);
+      acc_re[i] = _mm256_fmadd_pd(ar, br, acc_re[i]);
+      acc_re[i] = _mm256_fnmadd_pd(ai, bi, acc_re[i]);
+      acc_im[i] = _mm256_fmadd_pd(ar, bi, acc_im[i]);
+      acc_im[i] = _mm256_fmadd_pd(ai, br, acc_im[i]);
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    if (accumulate) {
+      acc_re[i] = _mm256_add_pd(acc_re[i], _mm256_loadu_pd(c_re + i * ldc));
+      acc_im[i] = _mm256_add_pd(acc_im[i], _mm256_loadu_pd(c_im + i * ldc));
+    }
+    _mm256_storeu_pd(c_re + i * ldc, acc_re[i]);
+    _mm256_storeu_pd(c_im + i * ldc, acc_im[i]);
+  }
+}
+
+__attribute__((target("avx512f")))
+static void gemm_microkernel_avx512(size_t kc, const double* a_re, const double* a_im, const double* b_re,
+                                    const double* b_im, double* c_re, double* c_im, size_t ldc, bool accumulate) {
+  __m512d acc_re[4], acc_im[4];
+  for (int i = 0; i < 4; i++) {
+    acc_re[i] = _mm512_setzero_pd();
+    acc_im[i] = _mm512_setzero_pd();
+  }
+  for (size_t k = 0; k < kc; k++) {
+    __m512d br = _mm512_loadu_pd(b_re + k * 8);
+    __m512d bi = _mm512_loadu_pd(b_im + k * 8);
+    for (int i = 0; i < 4; i++) {
+      __m512d ar = _mm512_set1_pd(a_re[k * 4 + i]);
+      __m512d ai = _mm512_set1_pd(a_im[k * 4 + i]);
+      acc_re[i] = _mm512_fmadd_pd(ar, br, acc_re[i]);
+      acc_re[i] = _mm512_fnmadd_pd(ai, bi, acc_re[i]);
+      acc_im[i] = _mm512_fmadd_pd(ar, bi, acc_im[i]);
+      acc_im[i] = _mm512_fmadd_pd(ai, br, acc_im[i]);
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    if (accumulate) {
+      acc_re[i] = _mm512_add_pd(acc_re[i], _mm512_loadu_pd(c_re + i * ldc));
+      acc_im[i] = _mm512_add_pd(acc_im[i], _mm512_loadu_pd(c_im + i * ldc));
+    }
+    _mm512_storeu_pd(c_re + i * ldc, acc_re[i]);
+    _mm512_storeu_pd(c_im + i * ldc, acc_im[i]);
+  }
+}
+#endif
+
+static const gemm_isa gemm_isa_scalar = {"scalar", 4, 4, gemm_microkernel_scalar};
+#if defined(__x86_64__)
+static const gemm_isa gemm_isa_avx2 = {"avx2", 4, 4, gemm_microkernel_avx2};
+static const gemm_isa gemm_isa_avx512 = {"avx512", 4, 8, gemm_microkernel_avx512};
+#endif
+
+static const gemm_isa* gemm_select_isa() {
+  switch (dash_select_isa("DASH_GEMM_ISA")) {
+#if defined(__x86_64__)
+    case DASH_ISA_AVX512:
+      return &gemm_isa_avx512;
+    case DASH_ISA_AVX2:
+      return &gemm_isa_avx2;
+#endif
+    default:
+      return &gemm_isa_scalar;
+  }
+}
+
+static const gemm_isa* gemm_active_isa() {
+  static const gemm_isa* isa = gemm_select_isa();
+  return isa;
+}
+
+static size_t gemm_thread_count() {
+  static const size_t threads = []() {
+    const char* requested = getenv("DASH_GEMM_THREADS");
+    int count = (requested != nullptr) ? atoi(requested) : 1;
+    return (size_t) (count > 0 ? count : 1);
+  }();
+  return threads;
+}
+
+// Packing buffers are reused across calls on the same thread
+struct gemm_pack_buffers {
+  double* a = nullptr;
+  double* b = nullptr;
+
+  ~gemm_pack_buffers() {
+    free(a);
+    free(b);
+  }
+
+  void ensure_allocated() {
+    if (a == nullptr) {
+      a = (double*) aligned_alloc(64, 2 * GEMM_MC * GEMM_KC * sizeof(double));
+      b = (double*) aligned_alloc(64, 2 * GEMM_KC * GEMM_NC * sizeof(double));
+      if (a == nullptr || b == nullptr) {
+        fprintf(stderr, "[libdash] Failed to allocate GEMM packing buffers!\n");
+        exit(1);
+      }
+    }
+  }
+};
+static thread_local gemm_pack_buffers gemm_buffers;
+
+// Packs rows [i0, i0 + mc) and columns [k0, k0 + kc) of A into MR-row strips, k-major within each strip
+static void gemm_pack_a(const double* A, size_t lda, size_t i0, size_t mc, size_t k0, size_t kc, size_t mr, double* packed) {
+  for (size_t is = 0; is < mc; is += mr) {
+    for (size_t k = 0; k < kc; k++) {
+      for (size_t ii = 0; ii < mr; ii++) {
+        *packed++ = (is + ii < mc) ? A[(i0 + is + ii) * lda + k0 + k] : 0.0;
+      }
+    }
+  }
+}
+
+// Packs rows [k0, k0 + kc) and columns [j0, j0 + nc) of B into NR-column strips, k-major within each strip
+static void gemm_pack_b(const double* B, size_t ldb, size_t k0, size_t kc, size_t j0, size_t nc, size_t nr, double* packed) {
+  for (size_t js = 0; js < nc; js += nr) {
+    size_t width = (nc - js < nr) ? nc - js : nr;
+    for (size_t k = 0; k < kc; k++) {
+      const double* row = B + (k0 + k) * ldb + j0 + js;
+      size_t jj = 0;
+      for (; jj < width; jj++) {
+        *packed++ = row[jj];
+      }
+      for (; jj < nr; jj++) {
+        *packed++ = 0.0;
+      }
+    }
+  }
+}
+
+static void gemm_blocked(const double* A_re, const double* A_im, const double* B_re, const double* B_im, double* C_re,
+                         double* C_im, size_t row_begin, size_t row_end, size_t K, size_t N, const gemm_isa* isa) {
+  const size_t mr = isa->mr;
+  const size_t nr = isa->nr;
+  gemm_buffers.ensure_allocated();
+  double* pa_re = gemm_buffers.a;
+  double* pa_im = gemm_buffers.a + GEMM_MC * GEMM_KC;
+  double* pb_re = gemm_buffers.b;
+  double* pb_im = gemm_buffers.b + GEMM_KC * GEMM_NC;
+  double tile_re[GEMM_MAX_MR * GEMM_MAX_NR];
+  double tile_im[GEMM_MAX_MR * GEMM_MAX_NR];
+
+  for (size_t jc = 0; jc < N; jc += GEMM_NC) {
+    size_t nc = (N - jc < GEMM_NC) ? N - jc : GEMM_NC;
+    for (size_t pc = 0; pc < K; pc += GEMM_KC) {
+      size_t kc = (K - pc < GEMM_KC) ? K - pc : GEMM_KC;
+      bool accumulate = pc > 0;
+      gemm_pack_b(B_re, N, pc, kc, jc, nc, nr, pb_re);
+      gemm_pack_b(B_im, N, pc, kc, jc, nc, nr, pb_im);
+
+      for (size_t ic = row_begin; ic < row_end; ic += GEMM_MC) {
+        size_t mc = (row_end - ic < GEMM_MC) ? row_end - ic : GEMM_MC;
+        gemm_pack_a(A_re, K, ic, mc, pc, kc, mr, pa_re);
+        gemm_pack_a(A_im, K, ic, mc, pc, kc, mr, pa_im);
+
+        for (size_t jr = 0; jr < nc; jr += nr) {
+          for (size_t ir = 0; ir < mc; ir += mr) {
+            double* c_re = C_re + (ic + ir) * N + jc + jr;
+            double* c_im = C_im + (ic + ir) * N + jc + jr;
+            if (ir + mr <= mc && jr + nr <= nc) {
+              isa->microkernel(kc, pa_re + ir * kc, pa_im + ir * kc, pb_re + jr * kc, pb_im + jr * kc, c_re, c_im, N, accumulate);
+              continue;
+            }
+            // Partial tile on the bottom/right edge: compute a full tile and keep the part that exists in C
+            isa->microkernel(kc, pa_re + ir * kc, pa_im + ir * kc, pb_re + jr * kc, pb_im + jr * kc, tile_re, tile_im, nr, false);
+            size_t rows = (mc - ir < mr) ? mc - ir : mr;
+            size_t cols = (nc - jr < nr) ? nc - jr : nr;
+            for (size_t i = 0; i < rows; i++) {
+              for (size_t j = 0; j < cols; j++) {
+                c_re[i * N + j] = (accumulate ? c_re[i * N + j] : 0.0) + tile_re[i * nr + j];
+                c_im[i * N + j] = (accumulate ? c_im[i * N + j] : 0.0) + tile_im[i * nr + j];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Simple i-k-j loop: streams rows of B and C with unit stride, which is all small products need
+static void gemm_small(const double* A_re, const double* A_im, const double* B_re, const double* B_im, double* C_re,
+                       double* C_im, size_t M, size_t K, size_t N) {
+  for (size_t i = 0; i < M; i++) {
+    double* c_re = C_re + i * N;
+    double* c_im = C_im + i * N;
+    for (size_t j = 0; j < N; j++) {
+      c_re[j] = 0.0;
+      c_im[j] = 0.0;
+    }
+    for (size_t k = 0; k < K; k++) {
+      double ar = A_re[i * K + k];
+      double ai = A_im[i * K + k];
+      const double* b_re = B_re + k * N;
+      const double* b_im = B_im + k * N;
+      for (size_t j = 0; j < N; j++) {
+        c_re[j] += ar * b_re[j] - ai * b_im[j];
+        c_im[j] += ar * b_im[j] + ai * b_re[j];
+      }
+    }
+  }
+}
+
+struct gemm_panel_args {
+  const double *A_re, *A_im, *B_re, *B_im;
+  double *C_re, *C_im;
+  size_t row_begin, row_end, K, N;
+  const gemm_isa* isa;
+};
+
+static void* gemm_panel_thread(void* arg) {
+  gemm_panel_args* panel = (gemm_panel_args*) arg;
+  gemm_blocked(panel->A_re, panel->A_im, panel->B_re, panel->B_im, panel->C_re, panel->C_im, panel->row_begin,
+               panel->row_end, panel->K, panel->N, panel->isa);
+  return nullptr;
+}
+
+extern "C" void DASH_GEMM_cpu(double** A_re, double** A_im, double** B_re, double** B_im, double** C_re, double** C_im, size_t* A_ROWS, size_t* A_COLS, size_t* B_COLS) {
+  const size_t M = *A_ROWS;
+  // A_COLS better equal B_ROWS, I'm trusting you here >:(
+  const size_t K = *A_COLS;
+  const size_t N = *B_COLS;
+
+  if (M * K * N <= GEMM_SMALL_WORK) {
+    gemm_small(*A_re, *A_im, *B_re, *B_im, *C_re, *C_im, M, K, N);
+    return;
+  }
+
+  const gemm_isa* isa = gemm_active_isa();
+  size_t threads = gemm_thread_count();
+  // Give every thread at least one full row block
+  size_t max_threads = (M + GEMM_MC - 1) / GEMM_MC;
+  if (threads > max_threads) {
+    threads = max_threads;
+  }
+  if (threads <= 1) {
+    gemm_blocked(*A_re, *A_im, *B_re, *B_im, *C_re, *C_im, 0, M, K, N, isa);
+    return;
+  }
+
+  // Row panels are multiples of GEMM_MC so every thread packs whole blocks of A
+  size_t blocks_per_thread = (max_threads + threads - 1) / threads;
+  pthread_t panel_threads[threads];
+  gemm_panel_args panels[threads];
+  for (size_t t = 0; t < threads; t++) {
+    size_t begin = t * blocks_per_thread * GEMM_MC;
+    size_t end = (begin + blocks_per_thread * GEMM_MC < M) ? begin + blocks_per_thread * GEMM_MC : M;
+    panels[t] = {*A_re, *A_im, *B_re, *B_im, *C_re, *C_im, begin < M ? begin : M, end, K, N, isa};
+  }
+  // The calling thread takes the first panel itself
+  for (size_t t = 1; t < threads; t++) {
+    pthread_create(&panel_threads[t], nullptr, gemm_panel_thread, &panels[t]);
+  }
+  gemm_panel_thread(&panels[0]);
+  for (size_t t = 1; t < threads; t++) {
+    pthread_join(panel_threads[t], nullptr);
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * Instruction sets that libdash kernels provide hand-vectorized code paths for.
+ * Kernels pick one once, at their first call, with dash_select_isa.
+ */
+typedef enum dash_isa {
+  DASH_ISA_SCALAR,
+  DASH_ISA_AVX2,
+  DASH_ISA_AVX512
+} dash_isa_t;
+
+/*
+ * Returns the widest instruction set this CPU supports, unless the environment variable override_env_var names one
+ * ("avx512", "avx2" or "scalar") that it supports, in which case that one is used.
+ */
+static inline dash_isa_t dash_select_isa(const char* override_env_var) {
+  const char* requested = getenv(override_env_var);
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  bool has_avx512 = __builtin_cpu_supports("avx512f");
+  bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  if (requested != nullptr) {
+    if (strcmp(requested, "avx512") == 0 && has_avx512) {
+      return DASH_ISA_AVX512;
+    }
+    if (strcmp(requested, "avx2") == 0 && has_avx2) {
+      return DASH_ISA_AVX2;
+    }
+    if (strcmp(requested, "scalar") == 0) {
+      return DASH_ISA_SCALAR;
+    }
+    fprintf(stderr, "[libdash] %s=%s is not supported on this CPU, selecting automatically\n", override_env_var, requested);
+  }
+  if (has_avx512) {
+    return DASH_ISA_AVX512;
+  }
+  if (has_avx2) {
+    return DASH_ISA_AVX2;
+  }
+#else
+  if (requested != nullptr && strcmp(requested, "scalar") != 0) {
+    fprintf(stderr, "[libdash] %s=%s is not supported on this CPU, selecting automatically\n", override_env_var, requested);
+  }
+#endif
+  return DASH_ISA_SCALAR;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum dash_kernel_id {
+#define DASH_KERNEL(name, cpu_impl, work, buffers, splitter, ...) DASH_KERNEL_##name,
+#include "dash_kernels.def"
+#undef DASH_KERNEL
+  DASH_KERNEL_COUNT
+} dash_kernel_id_t;
+
+/*
+ * Type of each argument in a kernel's descriptor. Every argument is passed to the implementation by pointer,
+ * i.e. a DASH_ARG_F64_BUFFER argument arrives as a double** and a DASH_ARG_SIZE argument as a size_t*.
+ */
+typedef enum dash_arg_kind {
+  DASH_ARG_F64_BUFFER,
+  DASH_ARG_SIZE,
+  DASH_ARG_INT,
+  DASH_ARG_BOOL,
+  DASH_ARG_ZIP_OP
+} dash_arg_kind_t;
+
+// Storage for an argument value that differs between the parts of a split kernel call
+typedef union dash_arg_value {
+  double* f64_buffer;
+  size_t size;
+  int integer;
+} dash_arg_value_t;
+
+// How many doubles a kernel call reads or writes through one of its buffer arguments, starting at the pointer passed
+typedef struct dash_buffer_extent {
+  size_t length;
+  bool written;
+} dash_buffer_extent_t;
+
+/*
+ * Describes how the runtime may split one large call of a kernel into parts that run concurrently on different
+ * workers. Each part covers a contiguous range of the call's units (elements, rows, ...).
+ */
+typedef struct dash_kernel_splitter {
+  // Number of units the call can be divided into
+  size_t (*units)(void* const* args);
+  // Fills in the arguments of the part covering units [begin, end). Each either reuses the call's pointer or points
+  // into values, which lives as long as the part.
+  void (*part)(void* const* args, size_t begin, size_t end, void** part_args, dash_arg_value_t* values);
+  // Implementation run for each part, if it differs from the kernel's (it may take extra arguments)
+  void* part_run_function;
+} dash_kernel_splitter_t;
+
+typedef struct dash_kernel_descriptor {
+  const char* name;
+  size_t num_args;
+  const dash_arg_kind_t* arg_kinds;
+  void* run_function;
+  // Approximate cost of a call in multiply-adds (elements for ZIP), the unit of the runtime's split threshold and the
+  // input of its cost model
+  size_t (*work)(void* const* args);
+  // Fills in the extent of every DASH_ARG_F64_BUFFER argument of a call, indexed by argument position; task graphs
+  // derive their dependencies from these, and replays size their synthetic buffers by them
+  void (*buffers)(void* const* args, dash_buffer_extent_t* extents);
+  // nullptr if calls of this kernel are never split
+  const dash_kernel_splitter_t* splitter;
+} dash_kernel_descriptor_t;
+
+// Indexed by dash_kernel_id_t
+extern const dash_kernel_descriptor_t dash_kernel_registry[DASH_KERNEL_COUNT];
+
+/*
+ * One kernel call of a task graph, as libdash hands it to the runtime's enqueue_graph. Successors are indices of the
+ * nodes that may only start once this one has completed; num_predecessors counts the nodes this one waits for.
+ * Everything a node points to belongs to the graph and stays valid until the whole graph has completed. So do the
+ * per-node counters enqueue_graph is handed along with the nodes, which start out at num_predecessors.
+ */
+typedef struct dash_graph_node {
+  dash_kernel_id_t kernel_id;
+  // Pointers to the argument values, as enqueue_kernel receives them
+  void* const* args;
+  const size_t* successors;
+  size_t num_successors;
+  size_t num_predecessors;
+} dash_graph_node_t;
+
+/*
+ * Finds the DASH_alloc buffer that pointer points into, returning nonzero and the buffer's start and usable size if
+ * there is one. base and size may be NULL.
+ */
+int dash_buffer_find(const void* pointer, void** base, size_t* size);
+
+#ifdef __cplusplus
+} // Close 'extern "C"'
+#endif
@@ -0,0 +1,227 @@
+#include "dash.h"
+#include "dash_isa.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Element-wise DASH_ZIP kernels.
+ *
+ * The op is resolved once per call to a loop specialized for it, so the inner loops carry no branches and
+ * read the inputs through plain pointers. On x86-64 the loops use AVX-512 or AVX2+FMA intrinsics (selected once at
+ * runtime, or forced with DASH_ZIP_ISA=<avx512|avx2|scalar>), with a scalar remainder loop; elsewhere the portable
+ * loops are left to the compiler's auto-vectorizer. Every loop reads an element before writing the same element,
+ * so output may alias either input.
+ */
+
+typedef void (*zip_kernel_fn)(zip_op_t op, const double* in1, const double* in2, double* out, size_t n);
+
+static void zip_unsupported_op(zip_op_t op) {
+  fprintf(stderr, "[libdash] Unsupported DASH_ZIP op %d!\n", (int) op);
+  exit(1);
+}
+
+// Scalar element operations, shared by the portable kernels and the remainder loops of the SIMD kernels
+struct zip_add {
+  static double scalar(double a, double b) { return a + b; }
+};
+struct zip_sub {
+  static double scalar(double a, double b) { return a - b; }
+};
+struct zip_mult {
+  static double scalar(double a, double b) { return a * b; }
+};
+struct zip_div {
+  static double scalar(double a, double b) { return a / b; }
+};
+
+static inline void zip_cmp_mult_scalar(const double* a, const double* b, double* out) {
+  double re = a[0] * b[0] - a[1] * b[1];
+  double im = a[1] * b[0] + a[0] * b[1];
+  out[0] = re;
+  out[1] = im;
+}
+
+static inline void zip_cmp_conj_mult_scalar(const double* a, const double* b, double* out) {
+  double re = a[0] * b[0] + a[1] * b[1];
+  double im = a[1] * b[0] - a[0] * b[1];
+  out[0] = re;
+  out[1] = im;
+}
+
+static inline double zip_cmp_mag_scalar(const double* a) {
+  return sqrt(a[0] * a[0] + a[1] * a[1]);
+}
+
+namespace zip_portable {
+
+template <typename Op>
+static void real_op(const double* in1, const double* in2, double* out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = Op::scalar(in1[i], in2[i]);
+  }
+}
+
+static void fma_op(const double* in1, const double* in2, double* out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = in1[i] * in2[i] + out[i];
+  }
+}
+
+static void scale_op(const double* in1, const double* in2, double* out, size_t n) {
+  const double factor = in2[0];
+  for (size_t i = 0; i < n; i++) {
+    out[i] = in1[i] * factor;
+  }
+}
+
+static void zip(zip_op_t op, const double* in1, const double* in2, double* out, size_t n) {
+  switch (op) {
+    case ZIP_ADD:
+      real_op<zip_add>(in1, in2, out, n);
+      break;
+    case ZIP_SUB:
+      real_op<zip_sub>(in1, in2, out, n);
+      break;
+    case ZIP_MULT:
+      real_op<zip_mult>(in1, in2, out, n);
+      break;
+    case ZIP_DIV:
+      real_op<zip_div>(in1, in2, out, n);
+      break;
+    case ZIP_FMA:
+      fma_op(in1, in2, out, n);
+      break;
+    case ZIP_SCALE:
+      scale_op(in1, in2, out, n);
+      break;
+    case ZIP_CMP_MULT:
+      for (size_t i = 0; i < n; i++) {
+        zip_cmp_mult_scalar(in1 + 2 * i, in2 + 2 * i, out + 2 * i);
+      }
+      break;
+    case ZIP_CMP_CONJ_MULT:
+      for (size_t i = 0; i < n; i++) {
+        zip_cmp_conj_mult_scalar(in1 + 2 * i, in2 + 2 * i, out + 2 * i);
+      }
+      break;
+    case ZIP_CMP_MAG:
+      for (size_t i = 0; i < n; i++) {
+        out[i] = zip_cmp_mag_scalar(in1 + 2 * i);
+      }
+      break;
+    default:
+      zip_unsupported_op(op);
+  }
+}
+
+} // namespace zip_portable
+
+#if defined(__x86_64__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+namespace zip_avx2 {
+
+struct V {
+  typedef __m256d vec;
+  static const size_t width = 4;
+  static vec load(const double* p) { return _mm256_loadu_pd(p); }
+  static void store(double* p, vec v) { _mm256_storeu_pd(p, v); }
+  static vec set1(double x) { return _mm256_set1_pd(x); }
+  static vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+  static vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+  static vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+  static vec div(vec a, vec b) { return _mm256_div_pd(a, b); }
+  static vec fmadd(vec a, vec b, vec c) { return _mm256_fmadd_pd(a, b, c); }
+  // a * b for two interleaved complex numbers per vector
+  static vec cmul(vec a, vec b) {
+    vec b_re = _mm256_movedup_pd(b);
+    vec b_im = _mm256_permute_pd(b, 0xF);
+    vec a_swapped = _mm256_permute_pd(a, 0x5);
+    return _mm256_fmaddsub_pd(a, b_re, _mm256_mul_pd(a_swapped, b_im));
+  }
+  // a * conj(b)
+  static vec cmul_conj(vec a, vec b) {
+    vec b_re = _mm256_movedup_pd(b);
+    vec b_im = _mm256_permute_pd(b, 0xF);
+    vec a_swapped = _mm256_permute_pd(a, 0x5);
+    return _mm256_fmsubadd_pd(a, b_re, _mm256_mul_pd(a_swapped, b_im));
+  }
+  // Magnitudes of the width complex numbers held in lo and hi
+  static vec cmag(vec lo, vec hi) {
+    // unpack yields (re0, re2, re1, re3) and (im0, im2, im1, im3); restore the order after the sqrt
+    vec re = _mm256_unpacklo_pd(lo, hi);
+    vec im = _mm256_unpackhi_pd(lo, hi);
+    vec mag = _mm256_sqrt_pd(_mm256_fmadd_pd(re, re, _mm256_mul_pd(im, im)));
+    return _mm256_permute4x64_pd(mag, 0xD8);
+  }
+};
+
+#include "dash_zip_kernels.inc"
+
+} // namespace zip_avx2
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+namespace zip_avx512 {
+
+struct V {
+  typedef __m512d vec;
+  static const size_t width = 8;
+  static vec load(const double* p) { return _mm512_loadu_pd(p); }
+  static void store(double* p, vec v) { _mm512_storeu_pd(p, v); }
+  static vec set1(double x) { return _mm512_set1_pd(x); }
+  static vec add(vec a, vec b) { return _mm512_add_pd(a, b); }
+  static vec sub(vec a, vec b) { return _mm512_sub_pd(a, b); }
+  static vec mul(vec a, vec b) { return _mm512_mul_pd(a, b); }
+  static vec div(vec a, vec b) { return _mm512_div_pd(a, b); }
+  static vec fmadd(vec a, vec b, vec c) { return _mm512_fmadd_pd(a, b, c); }
+  static vec cmul(vec a, vec b) {
+    vec b_re = _mm512_movedup_pd(b);
+    vec b_im = _mm512_permute_pd(b, 0xFF);
+    vec a_swapped = _mm512_permute_pd(a, 0x55);
+    return _mm512_fmaddsub_pd(a, b_re, _mm512_mul_pd(a_swapped, b_im));
+  }
+  static vec cmul_conj(vec a, vec b) {
+    vec b_re = _mm512_movedup_pd(b);
+    vec b_im = _mm512_permute_pd(b, 0xFF);
+    vec a_swapped = _mm512_permute_pd(a, 0x55);
+    return _mm512_fmsubadd_pd(a, b_re, _mm512_mul_pd(a_swapped, b_im));
+  }
+  static vec cmag(vec lo, vec hi) {
+    const __m512i even = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+    const __m512i odd = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+    vec re = _mm512_permutex2var_pd(lo, even, hi);
+    vec im = _mm512_permutex2var_pd(lo, odd, hi);
+    return _mm512_sqrt_pd(_mm512_fmadd_pd(re, re, _mm512_mul_pd(im, im)));
+  }
+};
+
+#include "dash_zip_kernels.inc"
+
+} // namespace zip_avx512
+#pragma GCC pop_options
+#endif
+
+static zip_kernel_fn zip_select_kernel() {
+  switch (dash_select_isa("DASH_ZIP_ISA")) {
+#if defined(__x86_64__)
+    case DASH_ISA_AVX512:
+      return zip_avx512::zip;
+    case DASH_ISA_AVX2:
+      return zip_avx2::zip;
+#endif
+    default:
+      return zip_portable::zip;
+  }
+}
+
+extern "C" void DASH_ZIP_cpu(double** input_1, double** input_2, double** output, size_t* size, zip_op_t* op) {
+  static const zip_kernel_fn kernel = zip_select_kernel();
+  kernel(*op, *input_1, *input_2, *output, *size);
+}
@@ -1,4 +1,3 @@
-#include <vector>
 #include <string>
 
 #include <cstdarg>
@@ -9,194 +8,1000 @@
 #include <pthread.h>
 #include <string.h>
 #include <unistd.h>
-#include <deque>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
 #include "dash.h"
+#include "dash_completion.h"
+#include "dash_kernels.h"
+#include "cost_model.h"
+#include "cpu_affinity.h"
+#include "idle_strategy.h"
+#include "kernel_stream.h"
+#include "launch_manifest.h"
+#include "mpmc_queue.h"
+#include "processing_elements.h"
+#include "slab_pool.h"
+#include "trace.h"
 
 #define MAX_ARGS 15
-#define ENABLE_LOGGING
+#define READY_QUEUE_CAPACITY 4096
+#define WORKERS_ENV_VAR "MOCK_RUNTIME_WORKERS"
+#define IDLE_ENV_VAR "MOCK_RUNTIME_IDLE"
+#define SPLIT_THRESHOLD_ENV_VAR "MOCK_RUNTIME_SPLIT_THRESHOLD"
+#define PIN_ENV_VAR "MOCK_RUNTIME_PIN"
+#define CPUS_ENV_VAR "MOCK_RUNTIME_CPUS"
+#define SCHEDULER_ENV_VAR "MOCK_RUNTIME_SCHEDULER"
+#define PES_ENV_VAR "MOCK_RUNTIME_PES"
+#define TRACE_ENV_VAR "MOCK_RUNTIME_TRACE"
+#define INLINE_ENV_VAR "MOCK_RUNTIME_INLINE"
+#define MANIFEST_ENV_VAR "MOCK_RUNTIME_MANIFEST"
+#define RECORD_ENV_VAR "MOCK_RUNTIME_RECORD"
+#define REPLAY_ENV_VAR "MOCK_RUNTIME_REPLAY"
+// Calls with at least this much work per part (as estimated by the kernel's splitter) are split across workers
+#define DEFAULT_SPLIT_THRESHOLD (1 << 18)
+// Latency of handing a task to an idle worker assumed until the workers have measured it
+#define DEFAULT_HANDOFF_NS 2000.0
+// Handoff samples a worker collects before folding their average into the runtime-wide estimate
+#define HANDOFF_SAMPLES 32
 
+// Narration of every dispatch step on stdout, for debugging only: it serializes all threads on stdout. Configure with
+// -DMOCK_RUNTIME_LOGGING=ON to enable it; use --trace to see what the runtime did at full speed.
 #ifdef ENABLE_LOGGING
 #define LOG(...) printf(__VA_ARGS__ )
 #else
 #define LOG(...) 
 #endif
 
+// Task nodes carry either a registered kernel ID or this marker telling the runtime an application has exited
+#define POISON_PILL_ID DASH_KERNEL_COUNT
+
+// A task graph being executed: how many of its nodes have yet to complete, and how many unfinished predecessors each
+// node is still waiting for. The nodes and counters belong to the caller and stay valid until the graph's completion is
+// signalled.
+struct graph_run_t {
+  const dash_graph_node_t* nodes;
+  std::atomic<size_t>* waiting;
+  std::atomic<size_t> remaining;
+  dash_completion_t* completion;
+  int app_instance;
+  app_priority_t priority;
+};
+typedef struct graph_run_t graph_run;
+
+// Shared by the parts of a split kernel call; the last part to finish completes the call
+struct split_call_t {
+  std::atomic<size_t> remaining;
+  dash_completion_t* completion;
+  graph_run* graph;
+  size_t graph_node;
+};
+typedef struct split_call_t split_call;
+
 struct task_node_t {
-  std::string name;
-  std::vector<void*> args;
+  int kernel_id;
+  void* args[MAX_ARGS];
   void* run_function;
-  pthread_barrier_t* completion_barrier;
+  dash_completion_t* completion;
+  // Set when the task is a node of a task graph, in which case completing it releases the node's successors instead
+  // of signalling completion
+  graph_run* graph;
+  size_t graph_node;
+  // Set when this node is one part of a split call, in which case completion and graph are unused
+  split_call* split;
+  // Argument values that belong to this part of a split call, pointed to by args
+  dash_arg_value_t arg_values[MAX_ARGS];
+  // Size of the task in the kernel's work units, and what the cost model expected it to take when it was queued
+  size_t work;
+  double estimate_ns;
+  // Application instance that queued the task and its priority, and the task's ID in the trace (only set while tracing)
+  int app_instance;
+  app_priority_t priority;
+  uint64_t trace_id;
+  // When an application thread queued the task for an idle pool, if the handoff latency is being measured, else 0
+  uint64_t enqueue_ns;
+  // Next task in the overflow list of the worker that released this one, while its ready queue was full
+  task_node_t* overflow_next;
 };
 typedef struct task_node_t task_node;
 
-std::deque<task_node*> task_list;
-pthread_mutex_t task_list_mutex;
+// Task nodes are recycled through per-thread caches so that steady-state dispatch never touches the heap
+slab_pool<task_node> task_node_pool;
+slab_pool<split_call> split_call_pool;
+slab_pool<graph_run> graph_run_pool;
 
-// Declare extern kernel implementations
-extern "C" void DASH_FFT_cpu(double** input, double** output, size_t* size, bool* isForwardTransform);
-extern "C" void DASH_GEMM_cpu(double** A_re, double** A_im, double** B_re, double** B_im, double** C_re, double** C_im, size_t* A_ROWS, size_t* A_COLS, size_t* B_COLS);
-extern "C" void DASH_ZIP_cpu(double** input_1, double** input_2, double** output, size_t* size, zip_op_t* op);
-extern "C" void DASH_CONV_2D_cpu(double **input, int *height, int *width, double **mask, int *mask_size, double **output);
+// What workers do when they find no work, and where each of them sleeps if it parks
+idle_strategy_t idle_strategy = IDLE_PARK;
+idle_parker* worker_parkers = nullptr;
 
-extern "C" void enqueue_kernel(const char* kernel_name, ...) {
-  std::string kernel_str(kernel_name);
+// Number of workers in the pool, and how much work a call needs per part before it is split (0 disables splitting)
+int numWorkers = 1;
+size_t split_threshold = DEFAULT_SPLIT_THRESHOLD;
 
-  va_list args;
-  va_start(args, kernel_name);
-
-  if (kernel_str == "DASH_ZIP") {
-    LOG("[nk] I am inside the runtime's codebase, unpacking my args to enqueue a new ZIP task\n");
-
-    double** input_1 = va_arg(args, double**);
-    double** input_2 = va_arg(args, double**);
-    double** output = va_arg(args, double**);
-    size_t* size = va_arg(args, size_t*);
-    zip_op_t* op = va_arg(args, zip_op_t*);
-    // Last arg: needs to be the synchronization barrier
-    pthread_barrier_t* barrier = va_arg(args, pthread_barrier_t*);
-    va_end(args);
-
-    // Create some sort of task node to represent this task
-    task_node* new_node = (task_node*) calloc(1, sizeof(task_node));
-    new_node->name = "ZIP";
-    new_node->args.push_back(input_1);
-    new_node->args.push_back(input_2);
-    new_node->args.push_back(output);
-    new_node->args.push_back(size);
-    new_node->args.push_back(op);
-    new_node->run_function = (void*) DASH_ZIP_cpu;
-    new_node->completion_barrier = barrier; 
-    
-    LOG("[nk] I have finished initializing my ZIP node, pushing it onto the task list\n");
-
-    // Push this node onto the ready queue
-    // Note: this would be a GREAT place for a lock-free multi-producer queue
-    // Otherwise, every application trying to push in new work is going to get stuck waiting for some eventual ready queue mutex
-    pthread_mutex_lock(&task_list_mutex);
-    task_list.push_back(new_node);
-    pthread_mutex_unlock(&task_list_mutex);
-    LOG("[nk] I have pushed a new task onto the work queue, time to go sleep until it gets scheduled and completed\n");
-  } else if (kernel_str == "DASH_FFT") {
-    LOG("[nk] I am inside the runtime's codebase, unpacking my args to enqueue a new FFT task\n");
-
-    double** input = va_arg(args, double**);
-    double** output = va_arg(args, double**);
-    size_t* size = va_arg(args, size_t*);
-    bool* forwardTrans = va_arg(args, bool*);
-    // Last arg: needs to be the synchronization barrier
-    pthread_barrier_t* barrier = va_arg(args, pthread_barrier_t*);
-    va_end(args);
-
-    // Create some sort of task node to represent this task
-    task_node* new_node = (task_node*) calloc(1, sizeof(task_node));
-    new_node->name = "FFT";
-    new_node->args.push_back(input);
-    new_node->args.push_back(output);
-    new_node->args.push_back(size);
-    new_node->args.push_back(forwardTrans);
-    new_node->run_function = (void*) DASH_FFT_cpu;
-    new_node->completion_barrier = barrier; 
-    
-    LOG("[nk] I have finished initializing my FFT node, pushing it onto the task list\n");
-
-    // Push this node onto the ready queue
-    // Note: this would be a GREAT place for a lock-free multi-producer queue
-    // Otherwise, every application trying to push in new work is going to get stuck waiting for some eventual ready queue mutex
-    pthread_mutex_lock(&task_list_mutex);
-    task_list.push_back(new_node);
-    pthread_mutex_unlock(&task_list_mutex);
-    LOG("[nk] I have pushed a new task onto the work queue, time to go sleep until it gets scheduled and completed\n");
-  } else if (kernel_str == "DASH_GEMM") {
-    // Unpack args and enqueue an mmult task
-    double** A_re = va_arg(args, double**);
-    double** A_im = va_arg(args, double**);
-    double** B_re = va_arg(args, double**);
-    double** B_im = va_arg(args, double**);
-    double** C_re = va_arg(args, double**);
-    double** C_im = va_arg(args, double**);
-    size_t* A_Rows = va_arg(args, size_t*);
-    size_t* A_Cols = va_arg(args, size_t*);
-    size_t* B_Cols = va_arg(args, size_t*);
-    // Last arg: needs to be the synchronization barrier
-    pthread_barrier_t* barrier = va_arg(args, pthread_barrier_t*);
-    va_end(args);
-
-    // Create some sort of task node to represent this task
-    task_node* new_node = (task_node*) calloc(1, sizeof(task_node));
-    new_node->name = "GEMM";
-    new_node->args.push_back(A_re);
-    new_node->args.push_back(A_im);
-    new_node->args.push_back(B_re);
-    new_node->args.push_back(B_im);
-    new_node->args.push_back(C_re);
-    new_node->args.push_back(C_im);
-    new_node->args.push_back(A_Rows);
-    new_node->args.push_back(A_Cols);
-    new_node->args.push_back(B_Cols);
-    new_node->run_function = (void*) DASH_GEMM_cpu;
-    new_node->completion_barrier = barrier;
-
-    LOG("[nk] I have finished initializing my GEMM node, pushing it onto the task list\n");
-
-    // Push this node onto the ready queue
-    // Note: this would be a GREAT place for a lock-free multi-producer queue
-    // Otherwise, every application trying to push in new work is going to get stuck waiting for some eventual ready queue mutex
-    pthread_mutex_lock(&task_list_mutex);
-    task_list.push_back(new_node);
-    pthread_mutex_unlock(&task_list_mutex);
-    LOG("[nk] I have pushed a new task onto the work queue, time to go sleep until it gets scheduled and completed\n");
-  } else if (kernel_str == "DASH_CONV_2D") {
-    double **input = va_arg(args, double **);
-    int *height = va_arg(args, int *);
-    int *width = va_arg(args, int *);
-    double **mask = va_arg(args, double **);
-    int *mask_size = va_arg(args, int *);
-    double **output = va_arg(args, double **);
-     // Last arg: needs to be the synchronization barrier
-    pthread_barrier_t *barrier = va_arg(args, pthread_barrier_t *);
-    va_end(args);
-
-    // Create some sort of task node to represent this task
-    task_node* new_node = (task_node*) calloc(1, sizeof(task_node));
-    new_node->name = "CONV_2D";
-    new_node->args.push_back(input);
-    new_node->args.push_back(height);
-    new_node->args.push_back(width);
-    new_node->args.push_back(mask);
-    new_node->args.push_back(mask_size);
-    new_node->args.push_back(output);
-    new_node->run_function = (void*) DASH_CONV_2D_cpu;
-    new_node->completion_barrier = barrier;
-
-    LOG("[nk] I have finished initializing my CONV_2D node, pushing it onto the task list\n");
-
-    // Push this node onto the ready queue
-    // Note: this would be a GREAT place for a lock-free multi-producer queue
-    // Otherwise, every application trying to push in new work is going to get stuck waiting for some eventual ready queue mutex
-    pthread_mutex_lock(&task_list_mutex);
-    task_list.push_back(new_node);
-    pthread_mutex_unlock(&task_list_mutex);
-    LOG("[nk] I have pushed a new task onto the work queue, time to go sleep until it gets scheduled and completed\n");
-  } else if (kernel_str == "POISON_PILL") {
-    LOG("[nk] I am inside the runtime's codebase, injecting a poison pill to tell the host thread that I'm done executing\n");
-    va_end(args);
-
-    task_node* new_node = (task_node*) calloc(1, sizeof(task_node));
-    new_node->name = "POISON PILL";
-
-    pthread_mutex_lock(&task_list_mutex);
-    task_list.push_back(new_node);
-    pthread_mutex_unlock(&task_list_mutex);
-    LOG("[nk] I have pushed the poison pill onto the task list\n");
+// Which threads are pinned, and to which CPUs
+pin_mode_t pin_mode = PIN_NONE;
+cpu_list_t pin_cpus;
+
+// Home worker of the calling thread, handed out round-robin to threads the first time they need one
+thread_local int home_worker = -1;
+std::atomic<int> next_home_worker(0);
+
+// Tasks a worker thread released (graph successors) while the ready queue they were meant for was full, oldest first.
+// A worker never waits for room in a queue, which only it might be able to drain.
+thread_local bool on_worker_thread = false;
+thread_local task_node* overflow_head = nullptr;
+thread_local task_node* overflow_tail = nullptr;
+
+// Application instance run by the calling thread, -1 for threads the runtime didn't launch, and its priority
+thread_local int app_instance = -1;
+thread_local app_priority_t app_priority = PRIORITY_NORMAL;
+std::atomic<int> next_app_instance(0);
+
+// Task events are recorded here when the runtime runs with --trace
+trace_recorder* task_trace = nullptr;
+
+// Kernel calls are recorded here when the runtime runs with --record
+kernel_stream_recorder* kernel_stream = nullptr;
+
+// Written only by the worker itself, read after the pool has joined
+struct alignas(CACHE_LINE_SIZE) worker_stats_t {
+  size_t executed;
+  size_t stolen;
+  // Time spent on tasks (including the wait for their latency model), and tasks that took longer than their model
+  uint64_t busy_ns;
+  size_t overruns;
+  // Buffer arguments that weren't allocated with DASH_alloc and had to be staged for the PE
+  size_t staged;
+  // Handoff latencies measured since the last time they were folded into handoff_ns
+  uint64_t handoff_sum_ns;
+  size_t handoff_samples;
+};
+worker_stats_t* worker_stats = nullptr;
+
+// Number of application instances launched and how many of them have sent their poison pill
+int appInstances = 1;
+std::atomic<int> nbCompletedApps(0);
+// Set by whichever worker receives the final poison pill so that the rest of the pool can exit
+std::atomic<bool> runtime_done(false);
+
+int current_home_worker() {
+  if (home_worker < 0) {
+    home_worker = next_home_worker.fetch_add(1) % numWorkers;
+  }
+  return home_worker;
+}
+
+uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// The processing element types being emulated, the type of the PE each worker stands in for, and how many workers
+// can run each kernel
+std::vector<pe_type_t> pe_types;
+const pe_type_t** worker_pe = nullptr;
+int kernel_workers[DASH_KERNEL_COUNT];
+
+bool worker_supports(int worker_id, int kernel_id) {
+  return kernel_id == POISON_PILL_ID || worker_pe[worker_id]->kernels[kernel_id].supported;
+}
+
+// The first worker at or after start (wrapping around) that can run the kernel
+int next_supporting_worker(int start, int kernel_id) {
+  for (int i = 0; i < numWorkers; i++) {
+    int w = (start + i) % numWorkers;
+    if (worker_supports(w, kernel_id)) {
+      return w;
+    }
+  }
+  return start;
+}
+
+// Expected execution time of a queued task on the given worker: its PE's latency model if it has one for the kernel,
+// otherwise the host cost model's estimate made when the task was queued
+double estimate_on_worker(int worker_id, const task_node* node) {
+  if (node->kernel_id == POISON_PILL_ID) {
+    return 0;
+  }
+  const pe_kernel_model_t& model = worker_pe[worker_id]->kernels[node->kernel_id];
+  return model.modeled ? pe_model_ns(model, node->work) : node->estimate_ns;
+}
+
+// Buffer arguments of a task that a PE can't take in place because they weren't allocated with DASH_alloc
+size_t foreign_buffers(const task_node* node) {
+  const dash_kernel_descriptor_t* kernel = &dash_kernel_registry[node->kernel_id];
+  size_t foreign = 0;
+  for (size_t i = 0; i < kernel->num_args; i++) {
+    if (kernel->arg_kinds[i] == DASH_ARG_F64_BUFFER && !dash_buffer_find(*(double**) node->args[i], nullptr, nullptr)) {
+      foreign++;
+    }
+  }
+  return foreign;
+}
+
+/*
+ * Scheduling policies. A scheduler decides where a ready task waits and which task a worker runs next:
+ * - fifo: every worker owns a FIFO queue. Application threads push onto the queue of their home worker, so that
+ *   consecutive kernels of one application instance run on the same core and find its data in that core's caches.
+ *   A worker whose queue is empty steals from the other queues before it goes idle.
+ * - sjf: shortest estimated job first. One queue shared by all workers, ordered by the cost model's estimate, so a
+ *   tiny ZIP no longer waits behind a large GEMM.
+ * - eft: earliest finish time. Each task is placed on the worker whose queue (including the task it is running) is
+ *   estimated to drain first, counting the task's own expected time on that worker's PE but not the queued tasks of
+ *   lower priority, and workers only run what was placed on them.
+ * Whatever the policy, a task only ever runs on a worker whose processing element supports its kernel, and a worker
+ * runs the tasks of higher priority applications before any of lower priority it could run instead.
+ */
+enum scheduler_policy_t {
+  SCHEDULER_FIFO,
+  SCHEDULER_SJF,
+  SCHEDULER_EFT
+};
+
+bool parse_scheduler_policy(const char* name, scheduler_policy_t* policy) {
+  if (strcmp(name, "fifo") == 0) {
+    *policy = SCHEDULER_FIFO;
+  } else if (strcmp(name, "sjf") == 0) {
+    *policy = SCHEDULER_SJF;
+  } else if (strcmp(name, "eft") == 0) {
+    *policy = SCHEDULER_EFT;
   } else {
-    LOG("[nk] Unrecognized kernel specified! (%s)\n", kernel_name);
-    va_end(args);
+    return false;
+  }
+  return true;
+}
+
+class scheduler {
+public:
+  virtual ~scheduler() {}
+  virtual const char* name() const = 0;
+  // Queues a ready task, preferably for the given worker. Returns the worker that should run it, or -1 for any. If the
+  // queue is full, waits for room when blocking, or else leaves the task unqueued and returns SUBMIT_FULL.
+  virtual int submit(task_node* node, int preferred_worker, bool blocking) = 0;
+  // Takes the next task for a worker; stolen is set if it was meant for another worker
+  virtual bool next(int worker_id, task_node*& node, bool& stolen) = 0;
+  // Whether next() may find work for this worker (checked by parked workers)
+  virtual bool has_work(int worker_id) const = 0;
+  // Tasks waiting to run, across all workers
+  virtual size_t queued() const = 0;
+  // Whether a task submitted for one worker may be run by another
+  virtual bool shares_work() const = 0;
+  // Called by the worker after it has executed a task
+  virtual void finished(int, task_node*) {}
+};
+
+#define SUBMIT_FULL -2
+
+class fifo_scheduler : public scheduler {
+public:
+  explicit fifo_scheduler(int workers)
+      : num_workers(workers), queues(new mpmc_queue<task_node*>*[workers * PRIORITY_LEVELS]), victims(workers) {
+    // One queue per worker and priority
+    for (int q = 0; q < workers * PRIORITY_LEVELS; q++) {
+      queues[q] = new mpmc_queue<task_node*>(READY_QUEUE_CAPACITY);
+    }
+    // A worker may only steal from workers whose every queued task it can run, i.e. whose PE supports no kernel that
+    // its own PE doesn't. Victims are visited in ring order, starting after the thief.
+    for (int w = 0; w < workers; w++) {
+      for (int i = 1; i < workers; i++) {
+        int victim = (w + i) % workers;
+        bool subset = true;
+        for (int k = 0; k < DASH_KERNEL_COUNT && subset; k++) {
+          subset = worker_supports(w, k) || !worker_supports(victim, k);
+        }
+        if (subset) {
+          victims[w].push_back(victim);
+        }
+      }
+    }
+  }
+
+  ~fifo_scheduler() {
+    for (int q = 0; q < num_workers * PRIORITY_LEVELS; q++) {
+      delete queues[q];
+    }
+    delete[] queues;
+  }
+
+  const char* name() const { return "fifo"; }
+
+  int submit(task_node* node, int preferred_worker, bool blocking) {
+    int worker = next_supporting_worker(preferred_worker, node->kernel_id);
+    if (blocking) {
+      queue(worker, node->priority)->push(node);
+    } else if (!queue(worker, node->priority)->try_push(node)) {
+      return SUBMIT_FULL;
+    }
+    return worker;
+  }
+
+  bool next(int worker_id, task_node*& node, bool& stolen) {
+    // A higher priority task is stolen before a lower priority one is taken from the worker's own queue
+    for (int p = 0; p < PRIORITY_LEVELS; p++) {
+      stolen = false;
+      if (queue(worker_id, p)->try_pop(node)) {
+        return true;
+      }
+      for (int victim : victims[worker_id]) {
+        if (queue(victim, p)->try_pop(node)) {
+          stolen = true;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  bool has_work(int worker_id) const {
+    for (int p = 0; p < PRIORITY_LEVELS; p++) {
+      if (!queue(worker_id, p)->empty_approx()) {
+        return true;
+      }
+      for (int victim : victims[worker_id]) {
+        if (!queue(victim, p)->empty_approx()) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  size_t queued() const {
+    size_t total = 0;
+    for (int q = 0; q < num_workers * PRIORITY_LEVELS; q++) {
+      total += queues[q]->size_approx();
+    }
+    return total;
+  }
+
+  bool shares_work() const { return true; }
+
+private:
+  mpmc_queue<task_node*>* queue(int worker_id, int priority) const { return queues[worker_id * PRIORITY_LEVELS + priority]; }
+
+  int num_workers;
+  mpmc_queue<task_node*>** queues;
+  std::vector<std::vector<int>> victims;
+};
+
+class sjf_scheduler : public scheduler {
+public:
+  sjf_scheduler() : submitted(0), size(0) {
+    pthread_mutex_init(&mutex, nullptr);
+    for (int k = 0; k <= POISON_PILL_ID; k++) {
+      kernel_queued[k].store(0, std::memory_order_relaxed);
+    }
+    // The heap only grows past this if more tasks than that are ever waiting at once, and never shrinks
+    tasks.reserve(READY_QUEUE_CAPACITY);
+  }
+
+  ~sjf_scheduler() { pthread_mutex_destroy(&mutex); }
+
+  const char* name() const { return "sjf"; }
+
+  int submit(task_node* node, int, bool) {
+    pthread_mutex_lock(&mutex);
+    // Equal estimates run in submission order
+    tasks.push_back(entry{node->priority, node->estimate_ns, submitted++, node});
+    sift_up(tasks.size() - 1);
+    kernel_queued[node->kernel_id].fetch_add(1, std::memory_order_release);
+    size.store(tasks.size(), std::memory_order_release);
+    pthread_mutex_unlock(&mutex);
+    return -1;
+  }
+
+  bool next(int worker_id, task_node*& node, bool& stolen) {
+    stolen = false;
+    if (!has_work(worker_id)) {
+      return false;
+    }
+    pthread_mutex_lock(&mutex);
+    // The highest priority, shortest task this worker's PE can run; with a single PE type that is always the root
+    size_t best = 0;
+    if (!tasks.empty() && !worker_supports(worker_id, tasks[0].node->kernel_id)) {
+      best = tasks.size();
+      for (size_t i = 1; i < tasks.size(); i++) {
+        if (worker_supports(worker_id, tasks[i].node->kernel_id) && (best == tasks.size() || tasks[i] < tasks[best])) {
+          best = i;
+        }
+      }
+    }
+    bool found = best < tasks.size();
+    if (found) {
+      node = tasks[best].node;
+      remove(best);
+      kernel_queued[node->kernel_id].fetch_sub(1, std::memory_order_relaxed);
+      size.store(tasks.size(), std::memory_order_release);
+    }
+    pthread_mutex_unlock(&mutex);
+    return found;
+  }
+
+  // Only counts tasks this worker's PE can run, so that workers of other PEs stay parked while they wait
+  bool has_work(int worker_id) const {
+    for (int k = 0; k <= POISON_PILL_ID; k++) {
+      if (kernel_queued[k].load(std::memory_order_acquire) > 0 && worker_supports(worker_id, k)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t queued() const { return size.load(std::memory_order_acquire); }
+  bool shares_work() const { return true; }
+
+private:
+  struct entry {
+    app_priority_t priority;
+    double estimate_ns;
+    uint64_t sequence;
+    task_node* node;
+    bool operator<(const entry& other) const {
+      if (priority != other.priority) {
+        return priority < other.priority;
+      }
+      return estimate_ns != other.estimate_ns ? estimate_ns < other.estimate_ns : sequence < other.sequence;
+    }
+  };
+
+  // Binary min-heap on entry order, in tasks
+  void sift_up(size_t i) {
+    while (i > 0 && tasks[i] < tasks[(i - 1) / 2]) {
+      std::swap(tasks[i], tasks[(i - 1) / 2]);
+      i = (i - 1) / 2;
+    }
+  }
+
+  void sift_down(size_t i) {
+    while (true) {
+      size_t smallest = i;
+      for (size_t child = 2 * i + 1; child <= 2 * i + 2 && child < tasks.size(); child++) {
+        if (tasks[child] < tasks[smallest]) {
+          smallest = child;
+        }
+      }
+      if (smallest == i) {
+        return;
+      }
+      std::swap(tasks[i], tasks[smallest]);
+      i = smallest;
+    }
+  }
+
+  void remove(size_t i) {
+    tasks[i] = tasks.back();
+    tasks.pop_back();
+    if (i < tasks.size()) {
+      sift_up(i);
+      sift_down(i);
+    }
+  }
+
+  pthread_mutex_t mutex;
+  std::vector<entry> tasks;
+  uint64_t submitted;
+  std::atomic<size_t> size;
+  // Queued tasks per kernel, indexed by kernel ID with poison pills last
+  std::atomic<size_t> kernel_queued[POISON_PILL_ID + 1];
+};
+
+class eft_scheduler : public scheduler {
+public:
+  explicit eft_scheduler(int workers) : num_workers(workers), queues(new worker_queue[workers]) {
+    for (int w = 0; w < workers; w++) {
+      for (int p = 0; p < PRIORITY_LEVELS; p++) {
+        queues[w].tasks[p] = new mpmc_queue<task_node*>(READY_QUEUE_CAPACITY);
+      }
+    }
+  }
+
+  ~eft_scheduler() {
+    for (int w = 0; w < num_workers; w++) {
+      for (int p = 0; p < PRIORITY_LEVELS; p++) {
+        delete queues[w].tasks[p];
+      }
+    }
+    delete[] queues;
+  }
+
+  const char* name() const { return "eft"; }
+
+  int submit(task_node* node, int preferred_worker, bool blocking) {
+    // The preferred worker wins ties, which keeps an application's tasks together on an idle machine
+    int best = next_supporting_worker(preferred_worker, node->kernel_id);
+    double best_finish = backlog_ahead(best, node->priority) + estimate_on_worker(best, node);
+    for (int w = 0; w < num_workers; w++) {
+      if (!worker_supports(w, node->kernel_id)) {
+        continue;
+      }
+      double finish = backlog_ahead(w, node->priority) + estimate_on_worker(w, node);
+      if (finish < best_finish) {
+        best = w;
+        best_finish = finish;
+      }
+    }
+    // From here on the estimate is the one for the chosen worker, which finished() takes back off its backlog
+    node->estimate_ns = estimate_on_worker(best, node);
+    queues[best].backlog_ns[node->priority].fetch_add((int64_t) node->estimate_ns, std::memory_order_relaxed);
+    if (blocking) {
+      queues[best].tasks[node->priority]->push(node);
+    } else if (!queues[best].tasks[node->priority]->try_push(node)) {
+      queues[best].backlog_ns[node->priority].fetch_sub((int64_t) node->estimate_ns, std::memory_order_relaxed);
+      return SUBMIT_FULL;
+    }
+    return best;
+  }
+
+  bool next(int worker_id, task_node*& node, bool& stolen) {
+    stolen = false;
+    for (int p = 0; p < PRIORITY_LEVELS; p++) {
+      if (queues[worker_id].tasks[p]->try_pop(node)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool has_work(int worker_id) const {
+    for (int p = 0; p < PRIORITY_LEVELS; p++) {
+      if (!queues[worker_id].tasks[p]->empty_approx()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t queued() const {
+    size_t total = 0;
+    for (int w = 0; w < num_workers; w++) {
+      for (int p = 0; p < PRIORITY_LEVELS; p++) {
+        total += queues[w].tasks[p]->size_approx();
+      }
+    }
+    return total;
+  }
+
+  bool shares_work() const { return false; }
+
+  void finished(int worker_id, task_node* node) {
+    queues[worker_id].backlog_ns[node->priority].fetch_sub((int64_t) node->estimate_ns, std::memory_order_relaxed);
+  }
+
+private:
+  struct worker_queue {
+    // One queue per priority
+    mpmc_queue<task_node*>* tasks[PRIORITY_LEVELS];
+    // Estimated time to finish everything of each priority placed on this worker that hasn't finished yet
+    std::atomic<int64_t> backlog_ns[PRIORITY_LEVELS] = {};
+  };
+
+  // Backlog a task of the given priority would wait for on a worker: lower priority tasks don't hold it up
+  double backlog_ahead(int worker_id, app_priority_t priority) const {
+    int64_t backlog = 0;
+    for (int p = 0; p <= priority; p++) {
+      backlog += queues[worker_id].backlog_ns[p].load(std::memory_order_relaxed);
+    }
+    return (double) backlog;
+  }
+
+  int num_workers;
+  worker_queue* queues;
+};
+
+scheduler_policy_t scheduler_policy = SCHEDULER_FIFO;
+scheduler* task_scheduler = nullptr;
+// Execution time estimates per kernel type, refined with every task the workers execute
+cost_model kernel_costs(DASH_KERNEL_COUNT);
+
+void complete_task(task_node* node);
+
+/*
+ * Inline execution of small kernels. A kernel call whose estimated execution time is below the inline threshold runs
+ * directly on the calling application thread: for a ten-element ZIP, handing the task to a worker and signalling its
+ * completion back cost orders of magnitude more than the kernel itself. The threshold grows with the number of tasks
+ * already queued per worker that can run the kernel, since a dispatched call would wait behind them.
+ * - auto: the threshold is twice the measured latency from an application thread queueing a task on an idle pool to
+ *   a worker starting it, once for the trip to the worker and once for the completion's trip back.
+ * - <ns>: a fixed threshold.
+ * - off: every call goes through the workers.
+ * Only kernels that some PE runs at host speed are inlined, as the calling thread is a host CPU.
+ */
+enum inline_mode_t {
+  INLINE_OFF,
+  INLINE_FIXED,
+  INLINE_AUTO
+};
+
+bool parse_inline_mode(const char* text, inline_mode_t* mode, double* threshold_ns) {
+  if (strcmp(text, "auto") == 0) {
+    *mode = INLINE_AUTO;
+    return true;
+  }
+  if (strcmp(text, "off") == 0) {
+    *mode = INLINE_OFF;
+    return true;
+  }
+  char* end;
+  double ns = strtod(text, &end);
+  if (end == text || *end != '\0' || ns < 0) {
+    return false;
+  }
+  *mode = (ns > 0) ? INLINE_FIXED : INLINE_OFF;
+  *threshold_ns = ns;
+  return true;
+}
+
+inline_mode_t inline_mode = INLINE_AUTO;
+double inline_threshold_ns = 0;
+// Running estimate of the handoff latency, only measured (and used) in auto mode
+std::atomic<double> handoff_ns(DEFAULT_HANDOFF_NS);
+std::atomic<bool> handoff_measured(false);
+bool kernel_inlinable[DASH_KERNEL_COUNT];
+std::atomic<size_t> inlined_tasks[DASH_KERNEL_COUNT];
+
+// Decides whether a kernel task should run on the calling thread, and if not, whether its handoff is measured
+bool should_inline(task_node* node) {
+  node->enqueue_ns = 0;
+  if (inline_mode == INLINE_OFF || !kernel_inlinable[node->kernel_id]) {
+    return false;
+  }
+  size_t queued = task_scheduler->queued();
+  double threshold = (inline_mode == INLINE_AUTO) ? 2 * handoff_ns.load(std::memory_order_relaxed) : inline_threshold_ns;
+  threshold *= 1.0 + (double) queued / kernel_workers[node->kernel_id];
+  if (node->estimate_ns < threshold) {
+    return true;
+  }
+  if (inline_mode == INLINE_AUTO && queued == 0) {
+    node->enqueue_ns = now_ns();
+  }
+  return false;
+}
+
+// Called by a worker starting a task whose handoff is being measured
+void record_handoff(int worker_id, uint64_t start_ns, const task_node* node) {
+  worker_stats_t& stats = worker_stats[worker_id];
+  stats.handoff_sum_ns += start_ns - node->enqueue_ns;
+  if (++stats.handoff_samples == HANDOFF_SAMPLES) {
+    // Workers may overwrite each other's update; the estimate only needs to follow the trend
+    double average = (double) stats.handoff_sum_ns / HANDOFF_SAMPLES;
+    double previous = handoff_measured.exchange(true, std::memory_order_relaxed) ? handoff_ns.load(std::memory_order_relaxed) : average;
+    handoff_ns.store(0.75 * previous + 0.25 * average, std::memory_order_relaxed);
+    stats.handoff_sum_ns = 0;
+    stats.handoff_samples = 0;
+  }
+}
+
+// Runs a kernel task on the calling application thread, recording it the way a worker would
+void run_inline(task_node* node) {
+  void** args = node->args;
+  void (*run_func)(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
+  *reinterpret_cast<void **>(&run_func) = node->run_function;
+  if (task_trace != nullptr) {
+    node->trace_id = task_trace->next_task_id();
+    task_trace->record(TRACE_ENQUEUE, node->trace_id, node->kernel_id, node->app_instance, -1);
+    task_trace->record(TRACE_START, node->trace_id, node->kernel_id, node->app_instance, -1);
+  }
+  uint64_t start = now_ns();
+  (run_func)(args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7], args[8], args[9],
+             args[10], args[11], args[12], args[13], args[14]);
+  kernel_costs.record(node->kernel_id, node->work, now_ns() - start);
+  if (task_trace != nullptr) {
+    task_trace->record(TRACE_END, node->trace_id, node->kernel_id, node->app_instance, -1);
+  }
+  inlined_tasks[node->kernel_id].fetch_add(1, std::memory_order_relaxed);
+  complete_task(node);
+  if (task_trace != nullptr) {
+    task_trace->record(TRACE_COMPLETE, node->trace_id, node->kernel_id, node->app_instance, -1);
+  }
+  task_node_pool.release(node);
+}
+
+// Wakes the worker a queued task was meant for if it sleeps, otherwise anyone who may run it
+void wake_worker_for(const task_node* node, int worker) {
+  if (worker >= 0 && worker_parkers[worker].notify_one()) {
+    return;
+  }
+  if (worker < 0 || task_scheduler->shares_work()) {
+    for (int w = 0; w < numWorkers; w++) {
+      if (worker_supports(w, node->kernel_id) && worker_parkers[w].notify_one()) {
+        return;
+      }
+    }
+  }
+}
+
+void push_ready_task(task_node* node, int preferred_worker) {
+  if (task_trace != nullptr && node->kernel_id != POISON_PILL_ID) {
+    node->trace_id = task_trace->next_task_id();
+    task_trace->record(TRACE_ENQUEUE, node->trace_id, node->kernel_id, node->app_instance, -1);
+  }
+  // Application threads wait for room in a full queue; workers set the task aside (behind any already waiting) instead
+  int worker = SUBMIT_FULL;
+  if (!on_worker_thread || overflow_head == nullptr) {
+    worker = task_scheduler->submit(node, preferred_worker, !on_worker_thread);
+  }
+  if (worker == SUBMIT_FULL) {
+    node->overflow_next = nullptr;
+    if (overflow_tail != nullptr) {
+      overflow_tail->overflow_next = node;
+    } else {
+      overflow_head = node;
+    }
+    overflow_tail = node;
+    return;
+  }
+  wake_worker_for(node, worker);
+}
+
+// Queues as many of the calling worker's set-aside tasks as there is room for
+void drain_overflow() {
+  while (overflow_head != nullptr) {
+    int worker = task_scheduler->submit(overflow_head, current_home_worker(), false);
+    if (worker == SUBMIT_FULL) {
+      return;
+    }
+    task_node* node = overflow_head;
+    overflow_head = node->overflow_next;
+    if (overflow_head == nullptr) {
+      overflow_tail = nullptr;
+    }
+    wake_worker_for(node, worker);
+  }
+}
+
+/*
+ * Divides a large call of a splittable kernel into up to one part per idle worker, each covering a contiguous range
+ * of the call's units. Returns false (leaving node untouched) if the call should run as a single task.
+ */
+bool split_task(const dash_kernel_descriptor_t* kernel, task_node* node) {
+  const dash_kernel_splitter_t* splitter = kernel->splitter;
+  const size_t workers = kernel_workers[node->kernel_id];
+  if (splitter == nullptr || split_threshold == 0 || workers < 2) {
+    return false;
+  }
+  size_t parts = node->work / split_threshold;
+  // Workers that will be busy with already queued tasks wouldn't get to their part any sooner
+  size_t queued = task_scheduler->queued();
+  size_t idle_workers = (queued < workers) ? workers - queued : 0;
+  size_t units = splitter->units(node->args);
+  parts = std::min(parts, std::min(idle_workers, units));
+  if (parts < 2) {
+    return false;
+  }
+
+  LOG("[nk] Splitting this %s task into %zu parts\n", kernel->name, parts);
+  split_call* split = split_call_pool.acquire();
+  split->remaining.store(parts, std::memory_order_relaxed);
+  split->completion = node->completion;
+  split->graph = node->graph;
+  split->graph_node = node->graph_node;
+  void* part_run_function = (splitter->part_run_function != nullptr) ? splitter->part_run_function : kernel->run_function;
+  int worker = current_home_worker();
+
+  for (size_t p = 0; p < parts; p++) {
+    task_node* part = task_node_pool.acquire();
+    part->kernel_id = node->kernel_id;
+    for (size_t i = 0; i < MAX_ARGS; i++) {
+      part->args[i] = nullptr;
+    }
+    size_t begin = units * p / parts, end = units * (p + 1) / parts;
+    splitter->part(node->args, begin, end, part->args, part->arg_values);
+    part->run_function = part_run_function;
+    part->work = node->work / units * (end - begin) + node->work % units * (end - begin) / units;
+    part->estimate_ns = kernel_costs.estimate_ns(part->kernel_id, part->work);
+    part->completion = nullptr;
+    part->split = split;
+    part->app_instance = node->app_instance;
+    part->priority = node->priority;
+    part->enqueue_ns = 0;
+    // Spread the parts over the workers that can run them, starting at the caller's home worker, instead of leaving
+    // them to be stolen
+    worker = next_supporting_worker(worker, part->kernel_id);
+    push_ready_task(part, worker);
+    worker = (worker + 1) % numWorkers;
+  }
+  task_node_pool.release(node);
+  return true;
+}
+
+// Fills in what a kernel task needs beyond its kernel, arguments, completion, graph and app instance
+void prepare_kernel_task(const dash_kernel_descriptor_t* kernel, task_node* node) {
+  node->run_function = kernel->run_function;
+  node->split = nullptr;
+  node->work = kernel->work(node->args);
+  node->estimate_ns = kernel_costs.estimate_ns(node->kernel_id, node->work);
+  node->enqueue_ns = 0;
+}
+
+// Queues a node of a running task graph whose predecessors have all completed
+void dispatch_graph_node(graph_run* run, size_t index) {
+  const dash_graph_node_t* graph_node = &run->nodes[index];
+  const dash_kernel_descriptor_t* kernel = &dash_kernel_registry[graph_node->kernel_id];
+  task_node* node = task_node_pool.acquire();
+  node->kernel_id = graph_node->kernel_id;
+  for (size_t i = 0; i < MAX_ARGS; i++) {
+    node->args[i] = (i < kernel->num_args) ? graph_node->args[i] : nullptr;
+  }
+  node->completion = nullptr;
+  node->graph = run;
+  node->graph_node = index;
+  node->app_instance = run->app_instance;
+  node->priority = run->priority;
+  if (kernel_stream != nullptr) {
+    // Replays don't know about graphs: a node is recorded as a call of its application instance when it is released
+    kernel_stream->record(node->kernel_id, node->args, run->app_instance, run->priority, now_ns());
+  }
+  prepare_kernel_task(kernel, node);
+  // Successors are released by the worker that ran their last predecessor, which is also their preferred worker
+  if (!split_task(kernel, node)) {
+    push_ready_task(node, current_home_worker());
+  }
+}
+
+// Releases the successors of a graph node that has completed, and signals the caller once the whole graph has
+void complete_graph_node(graph_run* run, size_t index) {
+  const dash_graph_node_t* graph_node = &run->nodes[index];
+  for (size_t s = 0; s < graph_node->num_successors; s++) {
+    size_t successor = graph_node->successors[s];
+    if (run->waiting[successor].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      dispatch_graph_node(run, successor);
+    }
+  }
+  if (run->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    dash_completion_signal(run->completion);
+    graph_run_pool.release(run);
+  }
+}
+
+// Completes a kernel call once the node's kernel (or, for a split call, its last part) has executed
+void complete_task(task_node* node) {
+  split_call* split = node->split;
+  if (split == nullptr) {
+    if (node->graph == nullptr) {
+      dash_completion_signal(node->completion);
+    } else {
+      complete_graph_node(node->graph, node->graph_node);
+    }
+  } else if (split->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    if (split->graph == nullptr) {
+      dash_completion_signal(split->completion);
+    } else {
+      complete_graph_node(split->graph, split->graph_node);
+    }
+    split_call_pool.release(split);
+  }
+}
+
+// Queues a kernel call whose argument pointers are in args, signalling completion once it has run
+void enqueue_task(int kernel_id, void* const* args, dash_completion_t* completion) {
+  const dash_kernel_descriptor_t* kernel = &dash_kernel_registry[kernel_id];
+  if (kernel_workers[kernel_id] == 0) {
+    fprintf(stderr, "[nk] None of the processing elements can run %s tasks!\n", kernel->name);
     exit(1);
   }
+  if (kernel_stream != nullptr) {
+    kernel_stream->record(kernel_id, args, app_instance, app_priority, now_ns());
+  }
+
+  // Create some sort of task node to represent this task
+  task_node* new_node = task_node_pool.acquire();
+  new_node->kernel_id = kernel_id;
+  for (size_t i = 0; i < MAX_ARGS; i++) {
+    new_node->args[i] = (i < kernel->num_args) ? args[i] : nullptr;
+  }
+  new_node->completion = completion;
+  new_node->graph = nullptr;
+  new_node->app_instance = app_instance;
+  new_node->priority = app_priority;
+  prepare_kernel_task(kernel, new_node);
+
+  if (should_inline(new_node)) {
+    LOG("[nk] This %s task is cheaper to run than to hand off, running it on the calling thread\n", kernel->name);
+    run_inline(new_node);
+    return;
+  }
+
+  if (split_task(kernel, new_node)) {
+    LOG("[nk] I have pushed the parts of my task onto the work queue, time to go sleep until all of them have completed\n");
+    return;
+  }
+
+  LOG("[nk] I have finished initializing my %s node, pushing it onto the task list\n", kernel->name);
+
+  // Push this node onto the lock-free ready queue of this thread's home worker
+  push_ready_task(new_node, current_home_worker());
+  LOG("[nk] I have pushed a new task onto the work queue, time to go sleep until it gets scheduled and completed\n");
 }
 
+extern "C" void enqueue_kernel(dash_kernel_id_t kernel_id, ...) {
+  if ((unsigned) kernel_id >= DASH_KERNEL_COUNT) {
+    fprintf(stderr, "[nk] Unrecognized kernel specified! (%d)\n", (int) kernel_id);
+    exit(1);
+  }
+  const dash_kernel_descriptor_t* kernel = &dash_kernel_registry[kernel_id];
+  LOG("[nk] I am inside the runtime's codebase, unpacking my args to enqueue a new %s task\n", kernel->name);
+
+  va_list args;
+  va_start(args, kernel_id);
+  void* arg_pointers[MAX_ARGS];
+  for (size_t i = 0; i < kernel->num_args; i++) {
+    arg_pointers[i] = va_arg(args, void*);
+  }
+  // Last arg: needs to be the completion flag the caller is waiting on
+  dash_completion_t* completion = va_arg(args, dash_completion_t*);
+  va_end(args);
+  enqueue_task(kernel_id, arg_pointers, completion);
+}
+
+extern "C" void enqueue_graph(const dash_graph_node_t* nodes, std::atomic<size_t>* waiting, size_t count,
+                              dash_completion_t* completion) {
+  for (size_t i = 0; i < count; i++) {
+    if ((unsigned) nodes[i].kernel_id >= DASH_KERNEL_COUNT) {
+      fprintf(stderr, "[nk] Unrecognized kernel specified! (%d)\n", (int) nodes[i].kernel_id);
+      exit(1);
+    }
+    if (kernel_workers[nodes[i].kernel_id] == 0) {
+      fprintf(stderr, "[nk] None of the processing elements can run %s tasks!\n", dash_kernel_registry[nodes[i].kernel_id].name);
+      exit(1);
+    }
+  }
+  LOG("[nk] I am inside the runtime's codebase, enqueueing a graph of %zu tasks\n", count);
+  if (count == 0) {
+    dash_completion_signal(completion);
+    return;
+  }
+
+  graph_run* run = graph_run_pool.acquire();
+  run->nodes = nodes;
+  run->waiting = waiting;
+  run->remaining.store(count, std::memory_order_relaxed);
+  run->completion = completion;
+  run->app_instance = app_instance;
+  run->priority = app_priority;
+  // Only the nodes without predecessors are queued now; the rest follow as their predecessors complete. Until the last
+  // of these is queued, the graph can't complete, so run stays valid throughout the loop.
+  for (size_t i = 0; i < count; i++) {
+    if (nodes[i].num_predecessors == 0) {
+      dispatch_graph_node(run, i);
+    }
+  }
+  LOG("[nk] I have pushed the graph's first tasks onto the work queue, time to go sleep until all of them have completed\n");
+}
+
+void enqueue_poison_pill() {
+  LOG("[nk] I am inside the runtime's codebase, injecting a poison pill to tell the host thread that I'm done executing\n");
+
+  task_node* new_node = task_node_pool.acquire();
+  new_node->kernel_id = POISON_PILL_ID;
+  new_node->graph = nullptr;
+  new_node->split = nullptr;
+  new_node->work = 0;
+  new_node->estimate_ns = 0;
+  new_node->app_instance = app_instance;
+  new_node->priority = app_priority;
+  new_node->enqueue_ns = 0;
+
+  push_ready_task(new_node, current_home_worker());
+  LOG("[nk] I have pushed the poison pill onto the task list\n");
+}
+
+// One application being run: what was asked for, its main function, and how the jobs of its instances went
+struct app_launch_t {
+  app_spec_t spec;
+  void* dlhandle;
+  void* func;
+  pthread_mutex_t stats_mutex;
+  std::vector<uint64_t> job_latency_ns;
+  size_t deadline_misses;
+  uint64_t first_release_ns;
+  uint64_t last_finish_ns;
+};
+
+// One instance of an application, with its own copy of the arguments
 struct user_obj_call_t {
-  void * func;
+  app_launch_t* app;
   int num_args;
   char** args;
 };
@@ -204,137 +1009,665 @@ struct user_obj_call_t {
 void thread_exec_function(void * call_setup) {
 
   user_obj_call_t * callStruct = (user_obj_call_t *)call_setup;
+  app_launch_t* app = callStruct->app;
+  app_instance = next_app_instance.fetch_add(1);
+  app_priority = app->spec.priority;
+
+  // Every application instance gets its own home worker (while there are enough), and shares its core if pinned
+  int home = current_home_worker();
+  if (pin_mode == PIN_ALL) {
+    pin_current_thread(&pin_cpus, home);
+  }
 
   // Cast our nullptr argument to a function pointer #justCThings
-  void (*libmain)(int, char**) = (void(*)(int, char**)) callStruct->func;
+  void (*libmain)(int, char**) = (void(*)(int, char**)) app->func;
+
+  // Jobs are released every period (back to back without one) and timed from their release until main returns
+  const uint64_t period_ns = (uint64_t) (app->spec.period_ms * 1e6);
+  const uint64_t deadline_ns = (uint64_t) (app->spec.deadline_ms * 1e6);
+  std::vector<uint64_t> latencies;
+  size_t misses = 0;
+  const uint64_t first_release = now_ns();
+  uint64_t finish = first_release;
+  std::vector<char*> job_args(callStruct->num_args + 1, nullptr);
+  for (int job = 0; job < app->spec.jobs; job++) {
+    uint64_t release = now_ns();
+    if (period_ns > 0) {
+      release = first_release + job * period_ns;
+      struct timespec ts = {(time_t) (release / 1000000000ull), (long) (release % 1000000000ull)};
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+      }
+    }
+    // main may rearrange its argv, so every job gets a fresh copy
+    std::copy(callStruct->args, callStruct->args + callStruct->num_args, job_args.begin());
 
-  // Call the function
-  (*libmain)(callStruct->num_args, callStruct->args);
+    // Call the function
+    (*libmain)(callStruct->num_args, job_args.data());
 
-  // Once the library's main function exits, enqueue a poison pill to tell the runtime
-  enqueue_kernel("POISON_PILL");
+    finish = now_ns();
+    latencies.push_back(finish - release);
+    misses += (deadline_ns > 0 && finish - release > deadline_ns) ? 1 : 0;
+  }
+
+  pthread_mutex_lock(&app->stats_mutex);
+  app->job_latency_ns.insert(app->job_latency_ns.end(), latencies.begin(), latencies.end());
+  app->deadline_misses += misses;
+  app->first_release_ns = std::min(app->first_release_ns, first_release);
+  app->last_finish_ns = std::max(app->last_finish_ns, finish);
+  pthread_mutex_unlock(&app->stats_mutex);
+
+  // Once the library's main function exits for the last time, enqueue a poison pill to tell the runtime
+  enqueue_poison_pill();
 }
 
-int main(int argc, char** argv) {
-  LOG("Launching the main function of the mock 'runtime' thread [cedr].\n\n");
+// Opens an application's shared object and looks up its main function
+bool open_app(app_launch_t* app) {
+  app->dlhandle = dlopen(app->spec.path.c_str(), RTLD_LAZY);
+  if (app->dlhandle == NULL) {
+    fprintf(stderr, "Unable to open child shared object: %s (perhaps prepend './'?)\n", app->spec.path.c_str());
+    return false;
+  }
 
-  pthread_mutex_init(&task_list_mutex, NULL);
-
-  std::string shared_object_name;
-  int appInstances = 1;
-  int nbCompletedApps = 0;
-  user_obj_call_t objCallStruct;
-  objCallStruct.args = new char * [argc]; // Create a new list of args, so we can control order
-  objCallStruct.num_args = 1;
-  
-  if (argc > 3) {
-    shared_object_name = std::string(argv[1]);
-    appInstances = atoi(argv[2]);
-    objCallStruct.num_args = argc - 2; // Assumes Call is "mock_runtime x.so 1 <args to x.so>
-
-    for(int i = 3; i < argc; i++)
-    {
-      objCallStruct.args[i - 2] = argv[i];
-    }
-  } else if (argc > 2) {
-    shared_object_name = std::string(argv[1]);
-    appInstances = atoi(argv[2]);
-  } else if (argc > 1){
-    shared_object_name = std::string(argv[1]);
-  } else {
-    shared_object_name = "./child.so";
+  app->func = (void*)dlsym(app->dlhandle, "main");
+
+  if (app->func == NULL) {
+    fprintf(stderr, "Unable to get function handle\n");
+    return false;
   }
+  pthread_mutex_init(&app->stats_mutex, nullptr);
+  app->deadline_misses = 0;
+  app->first_release_ns = UINT64_MAX;
+  app->last_finish_ns = 0;
+  return true;
+}
 
-  objCallStruct.args[0] = strdup(shared_object_name.c_str()); // Pass copy so we don't violate const
+void print_app_stats(app_launch_t* app) {
+  std::vector<uint64_t>& latencies = app->job_latency_ns;
+  if (latencies.empty()) {
+    return;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile_ms = [&latencies](double q) { return latencies[(size_t) (q * (latencies.size() - 1) + 0.5)] * 1e-6; };
+  double seconds = (app->last_finish_ns - app->first_release_ns) * 1e-9;
+  printf("[cedr] %s (%s priority): %d instances completed %zu jobs in %.3f s (%.1f jobs/s), latency p50 %.3f ms, "
+         "p99 %.3f ms, max %.3f ms", app->spec.path.c_str(), app_priority_name(app->spec.priority), app->spec.instances,
+         latencies.size(), seconds, latencies.size() / seconds, percentile_ms(0.5), percentile_ms(0.99), percentile_ms(1.0));
+  if (app->spec.deadline_ms > 0) {
+    printf(", %zu missed the %.3f ms deadline", app->deadline_misses, app->spec.deadline_ms);
+  }
+  printf("\n");
+}
 
-  void *dlhandle = dlopen(shared_object_name.c_str(), RTLD_LAZY);
-  if (dlhandle == NULL) {
-    fprintf(stderr, "Unable to open child shared object: %s (perhaps prepend './'?)\n", shared_object_name.c_str());
-    return -1;
-  } 
-  
-  objCallStruct.func = (void*)dlsym(dlhandle, "main");
+// One application instance of a recorded kernel stream, with synthetic buffers for every buffer argument it passes
+struct replay_instance_t {
+  int app_instance;
+  app_priority_t priority;
+  std::vector<const recorded_call_t*> calls;
+  double* buffers[DASH_KERNEL_COUNT][MAX_ARGS];
+  uint64_t start_ns;
+  uint64_t finish_ns;
+};
 
-  if (objCallStruct.func == NULL) {
-    fprintf(stderr, "Unable to get function handle\n");
-    return -1;
-  } 
+// Sizes an instance's buffers to the largest extent any of its calls needs, each kernel argument getting its own so that
+// no call reads what another wrote and the replayed kernels see the same data every run
+bool allocate_replay_buffers(replay_instance_t* instance) {
+  size_t lengths[DASH_KERNEL_COUNT][MAX_ARGS] = {};
+  for (const recorded_call_t* call : instance->calls) {
+    const dash_kernel_descriptor_t* kernel = &dash_kernel_registry[call->kernel_id];
+    for (size_t i = 0; i < kernel->num_args; i++) {
+      if (kernel->arg_kinds[i] == DASH_ARG_F64_BUFFER) {
+        lengths[call->kernel_id][i] = std::max(lengths[call->kernel_id][i], (size_t) call->values[i]);
+      }
+    }
+  }
+  for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+    for (size_t i = 0; i < MAX_ARGS; i++) {
+      instance->buffers[k][i] = nullptr;
+      if (lengths[k][i] > 0) {
+        instance->buffers[k][i] = (double*) DASH_alloc(lengths[k][i] * sizeof(double));
+        if (instance->buffers[k][i] == nullptr) {
+          return false;
+        }
+        std::fill(instance->buffers[k][i], instance->buffers[k][i] + lengths[k][i], 1.0);
+      }
+    }
+  }
+  return true;
+}
 
-  pthread_t worker_thread[appInstances];
-  LOG("[cedr] Launching %d instances of the received application!\n", appInstances);
-  for (size_t p = 0; p < appInstances; p++) {
-    // Before, we were just calling the provided shared object's main function directly
-    //pthread_create(&worker_thread[p], nullptr, (void *(*)(void *))lib_main, nullptr);
-    // Now, we call a wrapper function and pass the main function as an argument so that we can insert a hook for enqueueing a poison pill
-    // (or otherwise telling the runtime that the application is done executing)
-    pthread_create(&worker_thread[p], nullptr, (void *(*)(void *)) thread_exec_function, &objCallStruct);
+// Issues an instance's recorded calls in order, each once the previous one has completed, as fast as the runtime allows
+void replay_thread_function(void* replay_setup) {
+  replay_instance_t* instance = (replay_instance_t*) replay_setup;
+  app_instance = instance->app_instance;
+  app_priority = instance->priority;
+
+  int home = current_home_worker();
+  if (pin_mode == PIN_ALL) {
+    pin_current_thread(&pin_cpus, home);
   }
+
+  replay_arg_value_t values[MAX_ARGS];
   void* args[MAX_ARGS];
+  instance->start_ns = now_ns();
+  for (const recorded_call_t* call : instance->calls) {
+    decode_kernel_args(&dash_kernel_registry[call->kernel_id], call->values, instance->buffers[call->kernel_id], values, args);
+    dash_completion_t completion;
+    dash_completion_init(&completion);
+    enqueue_task(call->kernel_id, args, &completion);
+    dash_completion_wait(&completion);
+  }
+  instance->finish_ns = now_ns();
+
+  enqueue_poison_pill();
+}
+
+// Groups a recorded stream's calls by application instance, in the order the instances first called a kernel
+bool prepare_replay(const std::vector<recorded_call_t>& calls, std::vector<replay_instance_t>& instances) {
+  instances.clear();
+  std::vector<std::pair<int, size_t>> instance_index;
+  for (const recorded_call_t& call : calls) {
+    auto found = std::find_if(instance_index.begin(), instance_index.end(),
+                              [&call](const std::pair<int, size_t>& entry) { return entry.first == call.app_instance; });
+    if (found == instance_index.end()) {
+      instance_index.emplace_back(call.app_instance, instances.size());
+      instances.emplace_back();
+      instances.back().app_instance = call.app_instance;
+      instances.back().priority = (call.priority < PRIORITY_LEVELS) ? (app_priority_t) call.priority : PRIORITY_NORMAL;
+      found = instance_index.end() - 1;
+    }
+    instances[found->second].calls.push_back(&call);
+  }
+  for (replay_instance_t& instance : instances) {
+    if (!allocate_replay_buffers(&instance)) {
+      fprintf(stderr, "[cedr] Unable to allocate the buffers to replay application instance %d\n", instance.app_instance);
+      return false;
+    }
+  }
+  return true;
+}
+
+void* worker_thread_function(void* worker_arg) {
+  const int worker_id = (int)(intptr_t) worker_arg;
+  int idle_iterations = 0;
+  auto should_wake = [worker_id]() { return task_scheduler->has_work(worker_id) || runtime_done.load(); };
+  // Tasks this worker queues (graph nodes it releases) start out on its own queue, next to their inputs
+  home_worker = worker_id;
+  on_worker_thread = true;
+  if (pin_mode != PIN_NONE) {
+    pin_current_thread(&pin_cpus, worker_id);
+  }
 
   while (true) {
-    pthread_mutex_lock(&task_list_mutex);
-    if (!task_list.empty()) {
-      LOG("[cedr] I have a task to do!\n");
-      task_node* curr_node = task_list.front();
-      task_list.pop_front();
-      pthread_mutex_unlock(&task_list_mutex);
-
-      if (curr_node->name == "POISON PILL") {
-        LOG("[cedr] I received a poison pill task!\n");
-        nbCompletedApps++;
-        free(curr_node);
-        if (nbCompletedApps == appInstances) {
-          LOG("[cedr] Time to break out of my loop and die...\n");
-          break;
-        }
-        else {
-          continue;
-        }
-      }
+    drain_overflow();
+    task_node* curr_node;
+    bool stolen;
+    if (task_scheduler->next(worker_id, curr_node, stolen)) {
+      LOG("[cedr] Worker %d has a task to do%s!\n", worker_id, stolen ? " (stolen from another worker)" : "");
+      idle_iterations = 0;
 
-      LOG("[cedr] It is time for me to process a node named %s\n", curr_node->name.c_str());
-      
-      if (curr_node->args.size() > MAX_ARGS) {
-        fprintf(stderr, "[cedr] This node has too many arguments! I can't run it!\n");
-        exit(1);
-      }
-      for (size_t i = 0; i < curr_node->args.size(); i++) {
-        if (i < curr_node->args.size()) {
-          args[i] = curr_node->args.at(i);
-        } else {
-          args[i] = nullptr;
+      if (curr_node->kernel_id == POISON_PILL_ID) {
+        LOG("[cedr] Worker %d received a poison pill task!\n", worker_id);
+        task_node_pool.release(curr_node);
+        if (nbCompletedApps.fetch_add(1) + 1 == appInstances) {
+          LOG("[cedr] All applications have completed, telling the worker pool to shut down\n");
+          runtime_done.store(true);
+          for (int w = 0; w < numWorkers; w++) {
+            worker_parkers[w].notify_all();
+          }
         }
+        continue;
       }
 
+      LOG("[cedr] Worker %d is processing a node named %s\n", worker_id, dash_kernel_registry[curr_node->kernel_id].name);
+
+      void** args = curr_node->args;
       void* task_run_func = curr_node->run_function;
       void (*run_func)(void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *, void *);
       *reinterpret_cast<void **>(&run_func) = task_run_func;  
 
       LOG("[cedr] Calling the implementation of this node\n");
+      if (task_trace != nullptr) {
+        task_trace->record(TRACE_START, curr_node->trace_id, curr_node->kernel_id, curr_node->app_instance, worker_id);
+      }
+      uint64_t start = now_ns();
+      if (curr_node->enqueue_ns != 0) {
+        record_handoff(worker_id, start, curr_node);
+      }
       (run_func)(args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7], args[8], args[9], 
                  args[10], args[11], args[12], args[13], args[14]);
-      
-      LOG("[cedr] Execution is complete. Triggering barrier so that the other thread continues execution\n");
-      pthread_barrier_wait(curr_node->completion_barrier);
-      
-      LOG("[cedr] Barrier finished, going to delete this task node now\n");
-      free(curr_node); 
+      uint64_t end = now_ns();
+      const pe_kernel_model_t& model = worker_pe[worker_id]->kernels[curr_node->kernel_id];
+      if (model.modeled) {
+        // Hold on to the result until the emulated PE would have produced it
+        uint64_t deadline = start + (uint64_t) pe_model_ns(model, curr_node->work);
+        if (model.staging_ns > 0) {
+          size_t foreign = foreign_buffers(curr_node);
+          deadline += (uint64_t) (model.staging_ns * foreign);
+          worker_stats[worker_id].staged += foreign;
+        }
+        if (end < deadline) {
+          struct timespec ts = {(time_t) (deadline / 1000000000ull), (long) (deadline % 1000000000ull)};
+          while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+          }
+          end = now_ns();
+        } else {
+          worker_stats[worker_id].overruns++;
+        }
+      } else {
+        // Only host-speed executions say anything about the kernel's cost on the host
+        kernel_costs.record(curr_node->kernel_id, curr_node->work, end - start);
+      }
+      worker_stats[worker_id].busy_ns += end - start;
+      task_scheduler->finished(worker_id, curr_node);
+      if (task_trace != nullptr) {
+        task_trace->record(TRACE_END, curr_node->trace_id, curr_node->kernel_id, curr_node->app_instance, worker_id);
+      }
+
+      LOG("[cedr] Execution is complete. Signalling completion so that the application thread continues execution\n");
+      complete_task(curr_node);
+      if (task_trace != nullptr) {
+        task_trace->record(TRACE_COMPLETE, curr_node->trace_id, curr_node->kernel_id, curr_node->app_instance, worker_id);
+      }
+      worker_stats[worker_id].executed++;
+      worker_stats[worker_id].stolen += stolen ? 1 : 0;
+
+      LOG("[cedr] Going to recycle this task node now\n");
+      task_node_pool.release(curr_node);
     } else {
-      pthread_mutex_unlock(&task_list_mutex);
+      if (runtime_done.load()) {
+        LOG("[cedr] Worker %d has nothing left to do, time to break out of my loop and die...\n", worker_id);
+        break;
+      }
+      if (overflow_head != nullptr) {
+        // The queue this worker's set-aside tasks go to is full of another worker's work; retry once it has room
+        sched_yield();
+        continue;
+      }
+      idle_wait(idle_strategy, worker_parkers[worker_id], idle_iterations, should_wake);
     }
-    pthread_yield();
   }
+  return nullptr;
+}
+
+void print_usage(const char* prog_name) {
+  fprintf(stderr, "Usage: %s [options] <app.so> [instances] [app args...]\n", prog_name);
+  fprintf(stderr, "       %s [options] --manifest <file>\n", prog_name);
+  fprintf(stderr, "       %s [options] --replay <file>\n", prog_name);
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  -w, --workers <count>  number of worker threads (env %s, default: online processors)\n", WORKERS_ENV_VAR);
+  fprintf(stderr, "  -i, --idle <spin|park> what idle workers do (env %s, default: park)\n", IDLE_ENV_VAR);
+  fprintf(stderr, "  -s, --split-threshold <work>\n");
+  fprintf(stderr, "                         minimum work per part when splitting large kernel calls across workers,\n");
+  fprintf(stderr, "                         0 to disable (env %s, default: %d)\n", SPLIT_THRESHOLD_ENV_VAR, DEFAULT_SPLIT_THRESHOLD);
+  fprintf(stderr, "  -p, --pin <none|workers|all>\n");
+  fprintf(stderr, "                         pin workers (and application threads, next to their home worker) to CPUs\n");
+  fprintf(stderr, "                         (env %s, default: none)\n", PIN_ENV_VAR);
+  fprintf(stderr, "  -c, --cpus <list>      CPUs to pin to, e.g. 0-3,8 (env %s, default: all allowed CPUs)\n", CPUS_ENV_VAR);
+  fprintf(stderr, "  -S, --scheduler <fifo|sjf|eft>\n");
+  fprintf(stderr, "                         scheduling policy (env %s, default: fifo)\n", SCHEDULER_ENV_VAR);
+  fprintf(stderr, "  -P, --pes <file>       emulate the processing elements described in file, one worker per PE;\n");
+  fprintf(stderr, "                         overrides --workers (env %s, default: --workers host-speed CPUs)\n", PES_ENV_VAR);
+  fprintf(stderr, "  -t, --trace <file>     record every task, write a Chrome trace to file and print per-kernel\n");
+  fprintf(stderr, "                         latency percentiles at shutdown (env %s, default: off)\n", TRACE_ENV_VAR);
+  fprintf(stderr, "  -I, --inline <auto|off|ns>\n");
+  fprintf(stderr, "                         run kernel calls estimated to take less than this on the calling thread;\n");
+  fprintf(stderr, "                         auto measures the cost of a handoff to a worker (env %s, default: auto)\n", INLINE_ENV_VAR);
+  fprintf(stderr, "  -m, --manifest <file>  launch the applications listed in file, each with its own instances,\n");
+  fprintf(stderr, "                         arguments, jobs, period, deadline and priority (env %s)\n", MANIFEST_ENV_VAR);
+  fprintf(stderr, "  -R, --record <file>    record every kernel call the applications make to file (env %s)\n", RECORD_ENV_VAR);
+  fprintf(stderr, "  --replay <file>        instead of launching applications, replay the kernel calls recorded in file\n");
+  fprintf(stderr, "                         on synthetic buffers, each instance's calls back to back (env %s)\n", REPLAY_ENV_VAR);
+}
 
-  for(size_t p = 0; p < appInstances; p++) {
-    pthread_join(worker_thread[p], nullptr);
+int main(int argc, char** argv) {
+  LOG("Launching the main function of the mock 'runtime' thread [cedr].\n\n");
+
+  for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+    if (dash_kernel_registry[k].num_args > MAX_ARGS) {
+      fprintf(stderr, "[cedr] Kernel %s has too many arguments! I can't run it!\n", dash_kernel_registry[k].name);
+      return -1;
+    }
   }
 
-  printf("[cedr] The worker thread has joined, shutting down...\n");
+  numWorkers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (getenv(WORKERS_ENV_VAR) != nullptr) {
+    numWorkers = atoi(getenv(WORKERS_ENV_VAR));
+  }
+  if (getenv(IDLE_ENV_VAR) != nullptr && !parse_idle_strategy(getenv(IDLE_ENV_VAR), &idle_strategy)) {
+    fprintf(stderr, "Unrecognized idle strategy in %s: %s\n", IDLE_ENV_VAR, getenv(IDLE_ENV_VAR));
+    return -1;
+  }
+  if (getenv(SPLIT_THRESHOLD_ENV_VAR) != nullptr) {
+    split_threshold = strtoull(getenv(SPLIT_THRESHOLD_ENV_VAR), nullptr, 10);
+  }
+  if (getenv(PIN_ENV_VAR) != nullptr && !parse_pin_mode(getenv(PIN_ENV_VAR), &pin_mode)) {
+    fprintf(stderr, "Unrecognized pinning mode in %s: %s\n", PIN_ENV_VAR, getenv(PIN_ENV_VAR));
+    return -1;
+  }
+  if (getenv(SCHEDULER_ENV_VAR) != nullptr && !parse_scheduler_policy(getenv(SCHEDULER_ENV_VAR), &scheduler_policy)) {
+    fprintf(stderr, "Unrecognized scheduling policy in %s: %s\n", SCHEDULER_ENV_VAR, getenv(SCHEDULER_ENV_VAR));
+    return -1;
+  }
+  if (getenv(INLINE_ENV_VAR) != nullptr && !parse_inline_mode(getenv(INLINE_ENV_VAR), &inline_mode, &inline_threshold_ns)) {
+    fprintf(stderr, "Unrecognized inline threshold in %s: %s\n", INLINE_ENV_VAR, getenv(INLINE_ENV_VAR));
+    return -1;
+  }
+  const char* pe_config = getenv(PES_ENV_VAR);
+  const char* trace_path = getenv(TRACE_ENV_VAR);
+  const char* manifest_path = getenv(MANIFEST_ENV_VAR);
+  const char* record_path = getenv(RECORD_ENV_VAR);
+  const char* replay_path = getenv(REPLAY_ENV_VAR);
+  allowed_cpu_list(&pin_cpus);
+  if (getenv(CPUS_ENV_VAR) != nullptr && !parse_cpu_list(getenv(CPUS_ENV_VAR), &pin_cpus)) {
+    fprintf(stderr, "Unrecognized CPU list in %s: %s\n", CPUS_ENV_VAR, getenv(CPUS_ENV_VAR));
+    return -1;
+  }
 
-  free(objCallStruct.args[0]);
-  delete[] objCallStruct.args;
+  // Consume any runtime options that precede the shared object name
+  int argi = 1;
+  while (argi < argc && argv[argi][0] == '-') {
+    std::string opt(argv[argi]);
+    if ((opt == "-w" || opt == "--workers") && argi + 1 < argc) {
+      numWorkers = atoi(argv[argi + 1]);
+      argi += 2;
+    } else if (opt.rfind("--workers=", 0) == 0) {
+      numWorkers = atoi(opt.c_str() + strlen("--workers="));
+      argi++;
+    } else if ((opt == "-i" || opt == "--idle") && argi + 1 < argc && parse_idle_strategy(argv[argi + 1], &idle_strategy)) {
+      argi += 2;
+    } else if (opt.rfind("--idle=", 0) == 0 && parse_idle_strategy(opt.c_str() + strlen("--idle="), &idle_strategy)) {
+      argi++;
+    } else if ((opt == "-s" || opt == "--split-threshold") && argi + 1 < argc) {
+      split_threshold = strtoull(argv[argi + 1], nullptr, 10);
+      argi += 2;
+    } else if (opt.rfind("--split-threshold=", 0) == 0) {
+      split_threshold = strtoull(opt.c_str() + strlen("--split-threshold="), nullptr, 10);
+      argi++;
+    } else if ((opt == "-p" || opt == "--pin") && argi + 1 < argc && parse_pin_mode(argv[argi + 1], &pin_mode)) {
+      argi += 2;
+    } else if (opt.rfind("--pin=", 0) == 0 && parse_pin_mode(opt.c_str() + strlen("--pin="), &pin_mode)) {
+      argi++;
+    } else if ((opt == "-c" || opt == "--cpus") && argi + 1 < argc && parse_cpu_list(argv[argi + 1], &pin_cpus)) {
+      argi += 2;
+    } else if (opt.rfind("--cpus=", 0) == 0 && parse_cpu_list(opt.c_str() + strlen("--cpus="), &pin_cpus)) {
+      argi++;
+    } else if ((opt == "-S" || opt == "--scheduler") && argi + 1 < argc && parse_scheduler_policy(argv[argi + 1], &scheduler_policy)) {
+      argi += 2;
+    } else if (opt.rfind("--scheduler=", 0) == 0 && parse_scheduler_policy(opt.c_str() + strlen("--scheduler="), &scheduler_policy)) {
+      argi++;
+    } else if ((opt == "-P" || opt == "--pes") && argi + 1 < argc) {
+      pe_config = argv[argi + 1];
+      argi += 2;
+    } else if (opt.rfind("--pes=", 0) == 0) {
+      pe_config = argv[argi] + strlen("--pes=");
+      argi++;
+    } else if ((opt == "-t" || opt == "--trace") && argi + 1 < argc) {
+      trace_path = argv[argi + 1];
+      argi += 2;
+    } else if (opt.rfind("--trace=", 0) == 0) {
+      trace_path = argv[argi] + strlen("--trace=");
+      argi++;
+    } else if ((opt == "-m" || opt == "--manifest") && argi + 1 < argc) {
+      manifest_path = argv[argi + 1];
+      argi += 2;
+    } else if (opt.rfind("--manifest=", 0) == 0) {
+      manifest_path = argv[argi] + strlen("--manifest=");
+      argi++;
+    } else if ((opt == "-R" || opt == "--record") && argi + 1 < argc) {
+      record_path = argv[argi + 1];
+      argi += 2;
+    } else if (opt.rfind("--record=", 0) == 0) {
+      record_path = argv[argi] + strlen("--record=");
+      argi++;
+    } else if (opt == "--replay" && argi + 1 < argc) {
+      replay_path = argv[argi + 1];
+      argi += 2;
+    } else if (opt.rfind("--replay=", 0) == 0) {
+      replay_path = argv[argi] + strlen("--replay=");
+      argi++;
+    } else if ((opt == "-I" || opt == "--inline") && argi + 1 < argc && parse_inline_mode(argv[argi + 1], &inline_mode, &inline_threshold_ns)) {
+      argi += 2;
+    } else if (opt.rfind("--inline=", 0) == 0 && parse_inline_mode(opt.c_str() + strlen("--inline="), &inline_mode, &inline_threshold_ns)) {
+      argi++;
+    } else {
+      print_usage(argv[0]);
+      return -1;
+    }
+  }
+  if (numWorkers < 1) {
+    numWorkers = 1;
+  }
+  if (pe_config == nullptr) {
+    pe_types = default_pe_types(numWorkers);
+  } else if (!load_pe_config(pe_config, pe_types)) {
+    return -1;
+  }
+  numWorkers = 0;
+  for (const pe_type_t& type : pe_types) {
+    numWorkers += type.count;
+  }
+  worker_pe = new const pe_type_t*[numWorkers];
+  for (int t = 0, w = 0; t < (int) pe_types.size(); t++) {
+    for (int i = 0; i < pe_types[t].count; i++) {
+      worker_pe[w++] = &pe_types[t];
+    }
+  }
+  for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+    kernel_workers[k] = 0;
+    kernel_inlinable[k] = false;
+    for (int w = 0; w < numWorkers; w++) {
+      kernel_workers[k] += worker_supports(w, k) ? 1 : 0;
+      kernel_inlinable[k] = kernel_inlinable[k] || (worker_supports(w, k) && !worker_pe[w]->kernels[k].modeled);
+    }
+  }
+  const int nargs = argc - argi + 1; // Number of arguments if the runtime options were not present
 
-  dlclose(dlhandle);
+  std::vector<app_spec_t> app_specs;
+  std::vector<recorded_call_t> recorded_calls;
+  std::vector<replay_instance_t> replay_instances;
+  if (replay_path != nullptr) {
+    if (nargs > 1 || manifest_path != nullptr) {
+      print_usage(argv[0]);
+      return -1;
+    }
+    if (!load_kernel_stream(replay_path, recorded_calls)) {
+      return -1;
+    }
+    if (recorded_calls.empty()) {
+      fprintf(stderr, "[cedr] %s doesn't record any kernel calls\n", replay_path);
+      return -1;
+    }
+    for (const recorded_call_t& call : recorded_calls) {
+      if (kernel_workers[call.kernel_id] == 0) {
+        fprintf(stderr, "[cedr] None of the processing elements can run the %s tasks %s calls for!\n",
+                dash_kernel_registry[call.kernel_id].name, replay_path);
+        return -1;
+      }
+    }
+    if (!prepare_replay(recorded_calls, replay_instances)) {
+      return -1;
+    }
+  } else if (manifest_path != nullptr) {
+    if (nargs > 1) {
+      print_usage(argv[0]);
+      return -1;
+    }
+    if (!load_launch_manifest(manifest_path, app_specs)) {
+      return -1;
+    }
+  } else if (nargs > 2) {
+    app_specs.push_back(default_app_spec(argv[argi], atoi(argv[argi + 1])));
+    // Assumes Call is "mock_runtime x.so 1 <args to x.so>
+    for (int i = argi + 2; i < argc; i++) {
+      app_specs[0].args.push_back(argv[i]);
+    }
+  } else if (nargs > 1) {
+    app_specs.push_back(default_app_spec(argv[argi], 1));
+  } else {
+    app_specs.push_back(default_app_spec("./child.so", 1));
+  }
+
+  // Every instance gets its own list of args, starting with the shared object's name
+  std::vector<app_launch_t> apps(app_specs.size());
+  std::vector<user_obj_call_t> instance_calls;
+  appInstances = (int) replay_instances.size();
+  for (size_t a = 0; a < apps.size(); a++) {
+    apps[a].spec = app_specs[a];
+    if (!open_app(&apps[a])) {
+      return -1;
+    }
+    for (int i = 0; i < apps[a].spec.instances; i++) {
+      user_obj_call_t objCallStruct;
+      objCallStruct.app = &apps[a];
+      objCallStruct.num_args = 1 + (int) apps[a].spec.args.size();
+      objCallStruct.args = new char * [objCallStruct.num_args];
+      objCallStruct.args[0] = strdup(apps[a].spec.path.c_str()); // Pass copy so we don't violate const
+      for (size_t arg = 0; arg < apps[a].spec.args.size(); arg++) {
+        objCallStruct.args[arg + 1] = strdup(apps[a].spec.args[arg].c_str());
+      }
+      instance_calls.push_back(objCallStruct);
+    }
+    appInstances += apps[a].spec.instances;
+  } 
+
+  switch (scheduler_policy) {
+    case SCHEDULER_SJF:
+      task_scheduler = new sjf_scheduler();
+      break;
+    case SCHEDULER_EFT:
+      task_scheduler = new eft_scheduler(numWorkers);
+      break;
+    default:
+      task_scheduler = new fifo_scheduler(numWorkers);
+  }
+  worker_parkers = new idle_parker[numWorkers];
+  if (trace_path != nullptr) {
+    task_trace = new trace_recorder();
+  }
+  if (record_path != nullptr) {
+    kernel_stream = new kernel_stream_recorder(now_ns());
+  }
+  worker_stats = new worker_stats_t[numWorkers]();
+
+  pthread_t worker_thread[numWorkers];
+  LOG("[cedr] Launching a pool of %d worker threads with the %s scheduler!\n", numWorkers, task_scheduler->name());
+  for (int t = 0, w = 0; t < (int) pe_types.size(); w += pe_types[t].count, t++) {
+    LOG("[cedr] Workers %d-%d emulate %s processing elements\n", w, w + pe_types[t].count - 1, pe_types[t].name.c_str());
+  }
+  for (int w = 0; w < numWorkers; w++) {
+    pthread_create(&worker_thread[w], nullptr, worker_thread_function, (void*)(intptr_t) w);
+  }
+
+  pthread_t app_thread[appInstances];
+  LOG("[cedr] Launching %d instances of %zu applications!\n", appInstances, apps.size());
+  for (int p = 0; p < appInstances; p++) {
+    if (!replay_instances.empty()) {
+      pthread_create(&app_thread[p], nullptr, (void *(*)(void *)) replay_thread_function, &replay_instances[p]);
+      continue;
+    }
+    // Before, we were just calling the provided shared object's main function directly
+    //pthread_create(&app_thread[p], nullptr, (void *(*)(void *))lib_main, nullptr);
+    // Now, we call a wrapper function and pass the main function as an argument so that we can insert a hook for enqueueing a poison pill
+    // (or otherwise telling the runtime that the application is done executing)
+    pthread_create(&app_thread[p], nullptr, (void *(*)(void *)) thread_exec_function, &instance_calls[p]);
+  }
+
+  for (int p = 0; p < appInstances; p++) {
+    pthread_join(app_thread[p], nullptr);
+  }
+  for (int w = 0; w < numWorkers; w++) {
+    pthread_join(worker_thread[w], nullptr);
+  }
+
+  printf("[cedr] The application and worker threads have joined, shutting down...\n");
+  printf("[cedr] Task node pool: %zu slabs allocated\n", task_node_pool.slab_count());
+  for (int w = 0; w < numWorkers; w++) {
+    printf("[cedr] Worker %d (%s) executed %zu tasks (%zu stolen), busy for %.3f ms", w, worker_pe[w]->name.c_str(),
+           worker_stats[w].executed, worker_stats[w].stolen, worker_stats[w].busy_ns * 1e-6);
+    if (worker_stats[w].overruns > 0) {
+      printf(", %zu took longer on the host than their latency model", worker_stats[w].overruns);
+    }
+    if (worker_stats[w].staged > 0) {
+      printf(", staged %zu buffers not allocated with DASH_alloc", worker_stats[w].staged);
+    }
+    printf("\n");
+  }
+  if (manifest_path != nullptr) {
+    for (app_launch_t& app : apps) {
+      print_app_stats(&app);
+    }
+  }
+  if (!replay_instances.empty()) {
+    uint64_t first_start = UINT64_MAX, last_finish = 0;
+    for (const replay_instance_t& instance : replay_instances) {
+      first_start = std::min(first_start, instance.start_ns);
+      last_finish = std::max(last_finish, instance.finish_ns);
+    }
+    double seconds = (last_finish - first_start) * 1e-9;
+    printf("[cedr] Replayed %zu kernel calls of %zu application instances with a makespan of %.3f ms, %.0f calls/s\n",
+           recorded_calls.size(), replay_instances.size(), seconds * 1e3, recorded_calls.size() / seconds);
+  }
+  for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+    if (inlined_tasks[k].load() > 0) {
+      printf("[cedr] Ran %zu %s tasks inline on application threads\n", inlined_tasks[k].load(), dash_kernel_registry[k].name);
+    }
+  }
+  if (inline_mode == INLINE_AUTO) {
+    printf("[cedr] Kernels estimated below %.0f ns ran inline, twice the %s %.0f ns it takes to hand a task to an idle worker\n",
+           2 * handoff_ns.load(), handoff_measured.load() ? "measured" : "assumed", handoff_ns.load());
+  }
+  for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+    if (kernel_costs.samples(k) > 0) {
+      printf("[cedr] Cost model for %s: %.0f ns + %.3f ns per unit of work (%zu measurements)\n", dash_kernel_registry[k].name,
+             kernel_costs.fixed_ns(k), kernel_costs.per_unit_ns(k), kernel_costs.samples(k));
+    }
+  }
+  if (task_trace != nullptr) {
+    const char* kernel_names[DASH_KERNEL_COUNT];
+    for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+      kernel_names[k] = dash_kernel_registry[k].name;
+    }
+    task_trace->print_latency_summary(kernel_names, DASH_KERNEL_COUNT);
+    if (task_trace->dropped() > 0) {
+      printf("[cedr] The trace is missing the %zu oldest events, which were overwritten\n", task_trace->dropped());
+    }
+    if (task_trace->write_chrome_trace(trace_path, kernel_names)) {
+      printf("[cedr] Wrote the task trace to %s\n", trace_path);
+    } else {
+      fprintf(stderr, "[cedr] Unable to write the task trace to %s\n", trace_path);
+    }
+    delete task_trace;
+  }
+  if (kernel_stream != nullptr) {
+    size_t recorded = kernel_stream->write(record_path);
+    if (recorded != (size_t) -1) {
+      printf("[cedr] Recorded %zu kernel calls to %s\n", recorded, record_path);
+    } else {
+      fprintf(stderr, "[cedr] Unable to write the recorded kernel calls to %s\n", record_path);
+    }
+    delete kernel_stream;
+  }
+  for (replay_instance_t& instance : replay_instances) {
+    for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+      for (size_t i = 0; i < MAX_ARGS; i++) {
+        DASH_free(instance.buffers[k][i]);
+      }
+    }
+  }
+  delete task_scheduler;
+  delete[] worker_parkers;
+  delete[] worker_stats;
+  delete[] worker_pe;
+
+  for (user_obj_call_t& objCallStruct : instance_calls) {
+    for (int arg = 0; arg < objCallStruct.num_args; arg++) {
+      free(objCallStruct.args[arg]);
+    }
+    delete[] objCallStruct.args;
+  }
+  for (app_launch_t& app : apps) {
+    pthread_mutex_destroy(&app.stats_mutex);
+    dlclose(app.dlhandle);
+  }
   return 0;
 }
-
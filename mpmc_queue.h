@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <sched.h>
+
+#define CACHE_LINE_SIZE 64
+
+/*
+ * Bounded lock-free multi-producer/multi-consumer queue (Dmitry Vyukov's array-based design).
+ *
+ * Every slot carries a sequence number that tells producers and consumers whether the slot is free to be written
+ * or holds a value that is ready to be read, so each operation costs a single CAS on the shared head/tail counter
+ * in the uncontended case. Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class mpmc_queue {
+public:
+  explicit mpmc_queue(size_t requested_capacity) {
+    capacity = 2;
+    while (capacity < requested_capacity) {
+      capacity <<= 1;
+    }
+    mask = capacity - 1;
+    slots = new slot_t[capacity];
+    for (size_t i = 0; i < capacity; i++) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos.store(0, std::memory_order_relaxed);
+    dequeue_pos.store(0, std::memory_order_relaxed);
+  }
+
+  ~mpmc_queue() { delete[] slots; }
+
+  mpmc_queue(const mpmc_queue&) = delete;
+  mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+  // Returns false if the queue is full
+  bool try_push(const T& value) {
+    slot_t* slot;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots[pos & mask];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = value;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Applies backpressure to the producer by yielding until a slot frees up
+  void push(const T& value) {
+    while (!try_push(value)) {
+      sched_yield();
+    }
+  }
+
+  // Returns false if the queue is empty
+  bool try_pop(T& value) {
+    slot_t* slot;
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots[pos & mask];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) (pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    value = slot->value;
+    slot->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate number of queued elements; exact only when there are no concurrent operations
+  size_t size_approx() const {
+    size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+    size_t head = dequeue_pos.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  bool empty_approx() const { return size_approx() == 0; }
+
+private:
+  struct alignas(CACHE_LINE_SIZE) slot_t {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  slot_t* slots;
+  size_t capacity;
+  size_t mask;
+  // Keep the producer and consumer counters on separate cache lines so they don't false-share
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_pos;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_pos;
+};
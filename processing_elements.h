@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "dash_kernels.h"
+
+/*
+ * Emulated processing elements (PEs). Every worker thread of the runtime stands in for one PE, and each PE type
+ * declares which kernels it can run and how long they take there.
+ *
+ * A PE always computes a kernel with its *_cpu implementation. For kernels with a latency model the PE then stays busy
+ * until fixed_ns + ns_per_unit * work has passed since it started, as an accelerator with that launch/DMA overhead
+ * and throughput would. Kernels without a model take as long as they take on the host. A model can also charge
+ * staging_ns for every buffer argument that wasn't allocated with DASH_alloc, standing in for the copy into memory the
+ * PE can reach; DASH_alloc buffers are handed over in place.
+ *
+ * Configuration files have one PE type per line, '#' starts a comment:
+ *   <name> <count> <kernel>[:<fixed ns>[:<ns per unit of work>[:<staging ns per foreign buffer>]]] ...
+ * where <kernel> is a registered kernel name, or "all" for every kernel at host speed. For example
+ *   cpu         4  all
+ *   fft_accel   2  FFT:5000:0.05:2000
+ *   gemm_accel  1  GEMM:20000:0.02 ZIP:8000:0.1
+ */
+struct pe_kernel_model_t {
+  bool supported;
+  bool modeled;
+  double fixed_ns;
+  double ns_per_unit;
+  double staging_ns;
+};
+
+struct pe_type_t {
+  std::string name;
+  int count;
+  pe_kernel_model_t kernels[DASH_KERNEL_COUNT];
+};
+
+// Emulated execution time of a kernel with the given work on a PE of this type, if it has a model for it
+static inline double pe_model_ns(const pe_kernel_model_t& model, size_t work) {
+  return model.fixed_ns + model.ns_per_unit * (double) work;
+}
+
+// A single type of count host-speed PEs that run every kernel, i.e. a plain worker pool
+static inline std::vector<pe_type_t> default_pe_types(int count) {
+  pe_type_t cpu;
+  cpu.name = "cpu";
+  cpu.count = count;
+  for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+    cpu.kernels[k] = pe_kernel_model_t{true, false, 0, 0, 0};
+  }
+  return std::vector<pe_type_t>(1, cpu);
+}
+
+static inline bool parse_pe_kernel(const char* token, pe_type_t* type) {
+  if (strcmp(token, "all") == 0) {
+    for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+      type->kernels[k] = pe_kernel_model_t{true, false, 0, 0, 0};
+    }
+    return true;
+  }
+  std::string spec(token);
+  std::string name = spec.substr(0, spec.find(':'));
+  for (int k = 0; k < DASH_KERNEL_COUNT; k++) {
+    if (name != dash_kernel_registry[k].name) {
+      continue;
+    }
+    pe_kernel_model_t model = {true, false, 0, 0, 0};
+    if (name.size() < spec.size()) {
+      char* end;
+      const char* fields = token + name.size() + 1;
+      model.modeled = true;
+      model.fixed_ns = strtod(fields, &end);
+      if (end == fields || model.fixed_ns < 0) {
+        return false;
+      }
+      if (*end == ':') {
+        fields = end + 1;
+        model.ns_per_unit = strtod(fields, &end);
+        if (end == fields || model.ns_per_unit < 0) {
+          return false;
+        }
+        if (*end == ':') {
+          fields = end + 1;
+          model.staging_ns = strtod(fields, &end);
+          if (end == fields || model.staging_ns < 0) {
+            return false;
+          }
+        }
+      }
+      if (*end != '\0') {
+        return false;
+      }
+    }
+    type->kernels[k] = model;
+    return true;
+  }
+  return false;
+}
+
+// Reads PE types from a configuration file, reporting the offending line on error
+static inline bool load_pe_config(const char* path, std::vector<pe_type_t>& types) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    fprintf(stderr, "[cedr] Unable to open processing element configuration %s\n", path);
+    return false;
+  }
+  types.clear();
+  char line[1024];
+  int line_number = 0;
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), file) != nullptr) {
+    line_number++;
+    char* comment = strchr(line, '#');
+    if (comment != nullptr) {
+      *comment = '\0';
+    }
+    char* saveptr;
+    char* name = strtok_r(line, " \t\r\n", &saveptr);
+    if (name == nullptr) {
+      continue;
+    }
+    pe_type_t type;
+    type.name = name;
+    memset(type.kernels, 0, sizeof(type.kernels));
+    char* count = strtok_r(nullptr, " \t\r\n", &saveptr);
+    type.count = (count != nullptr) ? atoi(count) : 0;
+    ok = type.count > 0;
+    bool any_kernel = false;
+    for (char* token = strtok_r(nullptr, " \t\r\n", &saveptr); ok && token != nullptr; token = strtok_r(nullptr, " \t\r\n", &saveptr)) {
+      ok = parse_pe_kernel(token, &type);
+      any_kernel = true;
+    }
+    ok = ok && any_kernel;
+    if (ok) {
+      types.push_back(type);
+    } else {
+      fprintf(stderr, "[cedr] %s:%d: expected \"<name> <count> <kernel>[:<fixed ns>[:<ns per unit>[:<staging ns>]]] ...\"\n", path, line_number);
+    }
+  }
+  fclose(file);
+  if (ok && types.empty()) {
+    fprintf(stderr, "[cedr] %s does not declare any processing elements\n", path);
+    ok = false;
+  }
+  return ok;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <new>
+
+/*
+ * Allocation-free (in steady state) pool of fixed-size objects for producer/consumer hand-offs.
+ *
+ * Every thread that acquires objects gets its own cache, refilled from slabs of SlabSize objects. Objects are often
+ * released by a different thread than the one that acquired them (an application thread builds a task node, a worker
+ * retires it), so a release from a foreign thread pushes the object onto its home cache's lock-free "remote" stack,
+ * which the home thread reclaims in one exchange once its local free list runs dry. Caches outlive their threads:
+ * when a thread exits its cache is parked and later adopted by a new thread, so objects still in flight can always
+ * be returned.
+ *
+ * T must be trivially constructible; acquire() returns uninitialized storage. Thread caches are tracked per T, so
+ * there should be a single pool instance for any given T.
+ */
+template <typename T, size_t SlabSize = 64>
+class slab_pool {
+public:
+  slab_pool() : all_caches(nullptr), orphaned_caches(nullptr), slabs(nullptr), slab_allocs(0) {
+    pthread_mutex_init(&cache_mutex, nullptr);
+  }
+
+  ~slab_pool() {
+    while (slabs != nullptr) {
+      slab_header* next = slabs->next;
+      free(slabs);
+      slabs = next;
+    }
+    while (all_caches != nullptr) {
+      cache* next = all_caches->next_cache;
+      delete all_caches;
+      all_caches = next;
+    }
+    pthread_mutex_destroy(&cache_mutex);
+  }
+
+  slab_pool(const slab_pool&) = delete;
+  slab_pool& operator=(const slab_pool&) = delete;
+
+  T* acquire() {
+    cache* local = local_cache();
+    if (local->free_list == nullptr) {
+      local->free_list = local->remote_free.exchange(nullptr, std::memory_order_acquire);
+      if (local->free_list == nullptr) {
+        refill(local);
+      }
+    }
+    slot* s = local->free_list;
+    local->free_list = s->next;
+    return &s->value;
+  }
+
+  void release(T* value) {
+    slot* s = reinterpret_cast<slot*>(value);
+    cache* home = s->home;
+    if (home == tls_cache.local) {
+      s->next = home->free_list;
+      home->free_list = s;
+      return;
+    }
+    slot* head = home->remote_free.load(std::memory_order_relaxed);
+    do {
+      s->next = head;
+    } while (!home->remote_free.compare_exchange_weak(head, s, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  // Number of slabs requested from the heap so far; constant once the pool has warmed up
+  size_t slab_count() const { return slab_allocs.load(std::memory_order_relaxed); }
+
+private:
+  struct cache;
+
+  struct slot {
+    T value;
+    slot* next;
+    cache* home;
+  };
+
+  struct cache {
+    slot* free_list = nullptr;
+    std::atomic<slot*> remote_free{nullptr};
+    slab_pool* pool = nullptr;
+    cache* next_cache = nullptr;
+    cache* next_orphan = nullptr;
+  };
+
+  struct slab_header {
+    slab_header* next;
+  };
+
+  // Hands the calling thread's cache back to its pool when the thread exits
+  struct thread_cache_handle {
+    cache* local = nullptr;
+    ~thread_cache_handle() {
+      if (local != nullptr) {
+        local->pool->orphan(local);
+      }
+    }
+  };
+
+  static thread_local thread_cache_handle tls_cache;
+
+  cache* local_cache() {
+    if (tls_cache.local == nullptr) {
+      pthread_mutex_lock(&cache_mutex);
+      cache* adopted = orphaned_caches;
+      if (adopted != nullptr) {
+        orphaned_caches = adopted->next_orphan;
+      } else {
+        adopted = new cache();
+        adopted->pool = this;
+        adopted->next_cache = all_caches;
+        all_caches = adopted;
+      }
+      pthread_mutex_unlock(&cache_mutex);
+      tls_cache.local = adopted;
+    }
+    return tls_cache.local;
+  }
+
+  void orphan(cache* local) {
+    pthread_mutex_lock(&cache_mutex);
+    local->next_orphan = orphaned_caches;
+    orphaned_caches = local;
+    pthread_mutex_unlock(&cache_mutex);
+  }
+
+  void refill(cache* local) {
+    size_t header_size = (sizeof(slab_header) + alignof(slot) - 1) / alignof(slot) * alignof(slot);
+    char* memory = (char*) malloc(header_size + SlabSize * sizeof(slot));
+    if (memory == nullptr) {
+      fprintf(stderr, "[slab_pool] Failed to allocate a new slab!\n");
+      exit(1);
+    }
+    slab_header* header = reinterpret_cast<slab_header*>(memory);
+    pthread_mutex_lock(&cache_mutex);
+    header->next = slabs;
+    slabs = header;
+    pthread_mutex_unlock(&cache_mutex);
+    slab_allocs.fetch_add(1, std::memory_order_relaxed);
+
+    slot* slab_slots = reinterpret_cast<slot*>(memory + header_size);
+    for (size_t i = 0; i < SlabSize; i++) {
+      slot* s = new (&slab_slots[i]) slot();
+      s->home = local;
+      s->next = local->free_list;
+      local->free_list = s;
+    }
+  }
+
+  pthread_mutex_t cache_mutex;
+  cache* all_caches;
+  cache* orphaned_caches;
+  slab_header* slabs;
+  std::atomic<size_t> slab_allocs;
+};
+
+template <typename T, size_t SlabSize>
+thread_local typename slab_pool<T, SlabSize>::thread_cache_handle slab_pool<T, SlabSize>::tls_cache;
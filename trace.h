@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Low-overhead task tracing. Every thread that records an event gets its own ring buffer of fixed-size events, which
+ * only that thread ever writes, so recording takes no lock and no atomic read-modify-write: a timestamp counter read
+ * and a 24-byte store. Timestamps are converted to nanoseconds only when the trace is read. Once the ring is full the
+ * oldest events are overwritten. Rings are only read once every recording thread has been joined, to export a Chrome
+ * trace (chrome://tracing, ui.perfetto.dev) and per-kernel latency summaries.
+ */
+enum trace_event_type_t : uint8_t {
+  TRACE_ENQUEUE,    // an application thread handed the task to the runtime
+  TRACE_START,      // a worker started executing the task
+  TRACE_END,        // the worker finished executing it
+  TRACE_COMPLETE    // the runtime signalled the task's completion
+};
+
+struct trace_event_t {
+  uint64_t timestamp;
+  uint64_t task_id;
+  int16_t kernel_id;
+  int16_t app_instance;
+  int16_t worker;
+  trace_event_type_t type;
+};
+
+// Events kept per thread by default (ring sizes are rounded up to a power of two)
+#define TRACE_DEFAULT_RING_SIZE (1 << 16)
+
+static inline uint64_t trace_clock_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Raw event timestamps: the invariant TSC on x86, which is about half the cost of clock_gettime, else nanoseconds
+static inline uint64_t trace_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return trace_clock_ns();
+#endif
+}
+
+class trace_recorder {
+public:
+  explicit trace_recorder(size_t ring_size = TRACE_DEFAULT_RING_SIZE)
+      : ring_mask(round_up_pow2(ring_size) - 1), rings(nullptr), ring_count(0), origin_ticks(trace_ticks()),
+        origin_ns(trace_clock_ns()) {
+    pthread_mutex_init(&rings_mutex, nullptr);
+  }
+
+  ~trace_recorder() {
+    while (rings != nullptr) {
+      ring* next = rings->next;
+      free(rings->events);
+      delete rings;
+      rings = next;
+    }
+    pthread_mutex_destroy(&rings_mutex);
+  }
+
+  trace_recorder(const trace_recorder&) = delete;
+  trace_recorder& operator=(const trace_recorder&) = delete;
+
+  // A trace-wide unique ID for a new task, without any shared counter
+  uint64_t next_task_id() {
+    ring* r = local_ring();
+    return (r->index << 40) | r->next_task++;
+  }
+
+  void record(trace_event_type_t type, uint64_t task_id, int kernel_id, int app_instance, int worker) {
+    ring* r = local_ring();
+    trace_event_t* e = &r->events[r->recorded++ & ring_mask];
+    e->timestamp = trace_ticks();
+    e->task_id = task_id;
+    e->kernel_id = (int16_t) kernel_id;
+    e->app_instance = (int16_t) app_instance;
+    e->worker = (int16_t) worker;
+    e->type = type;
+  }
+
+  // Events overwritten because a ring was full; only valid once the recording threads have been joined
+  size_t dropped() const {
+    size_t total = 0;
+    for (ring* r = rings; r != nullptr; r = r->next) {
+      total += (r->recorded > ring_mask + 1) ? r->recorded - (ring_mask + 1) : 0;
+    }
+    return total;
+  }
+
+  /*
+   * Writes the trace in Chrome's JSON trace event format: one track per worker with a slice for every task it
+   * executed, and one track per application instance with a slice from each enqueue to the task's completion.
+   * kernel_names[k] names kernel ID k. Only valid once the recording threads have been joined.
+   */
+  bool write_chrome_trace(const char* path, const char* const* kernel_names) const {
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) {
+      return false;
+    }
+    std::vector<task_times> tasks = collect();
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"workers\"}},\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"applications\"}}");
+    uint64_t origin = UINT64_MAX;
+    for (const task_times& t : tasks) {
+      origin = std::min(origin, t.enqueue != 0 ? t.enqueue : t.start);
+    }
+    for (const task_times& t : tasks) {
+      const char* name = kernel_names[t.kernel_id];
+      if (t.start != 0 && t.end != 0) {
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"kernel\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"task\":%llu,\"app\":%d,\"queue_wait_us\":%.3f}}", name, t.worker, (t.start - origin) * 1e-3,
+                (t.end - t.start) * 1e-3, (unsigned long long) t.id, t.app_instance,
+                t.enqueue != 0 ? (t.start - t.enqueue) * 1e-3 : 0.0);
+      }
+      if (t.enqueue != 0 && t.complete != 0) {
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"request\",\"ph\":\"X\",\"pid\":2,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"task\":%llu}}", name, t.app_instance, (t.enqueue - origin) * 1e-3,
+                (t.complete - t.enqueue) * 1e-3, (unsigned long long) t.id);
+      }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+  }
+
+  /*
+   * Prints, per kernel type, percentiles of the time tasks waited in the ready queues (enqueue to start) and of
+   * their service time (start to end). Only valid once the recording threads have been joined.
+   */
+  void print_latency_summary(const char* const* kernel_names, int kernel_count) const {
+    std::vector<task_times> tasks = collect();
+    std::vector<std::vector<uint64_t>> wait(kernel_count), service(kernel_count);
+    for (const task_times& t : tasks) {
+      if (t.kernel_id < 0 || t.kernel_id >= kernel_count || t.start == 0 || t.end == 0) {
+        continue;
+      }
+      service[t.kernel_id].push_back(t.end - t.start);
+      if (t.enqueue != 0) {
+        wait[t.kernel_id].push_back(t.start - t.enqueue);
+      }
+    }
+    printf("[cedr] %-10s %8s %12s %12s %12s %12s %12s %12s\n", "kernel", "tasks", "wait p50 us", "wait p99 us",
+           "wait max us", "run p50 us", "run p99 us", "run max us");
+    for (int k = 0; k < kernel_count; k++) {
+      if (service[k].empty()) {
+        continue;
+      }
+      std::sort(wait[k].begin(), wait[k].end());
+      std::sort(service[k].begin(), service[k].end());
+      printf("[cedr] %-10s %8zu %12.2f %12.2f %12.2f %12.2f %12.2f %12.2f\n", kernel_names[k], service[k].size(),
+             percentile(wait[k], 0.5), percentile(wait[k], 0.99), percentile(wait[k], 1.0),
+             percentile(service[k], 0.5), percentile(service[k], 0.99), percentile(service[k], 1.0));
+    }
+  }
+
+private:
+  struct ring {
+    trace_event_t* events;
+    uint64_t recorded;
+    uint64_t index;
+    uint64_t next_task;
+    ring* next;
+  };
+
+  // Timestamps of one task, 0 where its event wasn't recorded (or was overwritten)
+  struct task_times {
+    uint64_t id;
+    int kernel_id, app_instance, worker;
+    uint64_t enqueue, start, end, complete;
+  };
+
+  static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  static double percentile(const std::vector<uint64_t>& sorted, double q) {
+    if (sorted.empty()) {
+      return 0;
+    }
+    size_t i = (size_t) (q * (sorted.size() - 1) + 0.5);
+    return sorted[i] * 1e-3;
+  }
+
+  ring* local_ring() {
+    // One ring per thread; a thread that switches to another recorder starts a new ring there
+    static thread_local const trace_recorder* owner = nullptr;
+    static thread_local ring* local = nullptr;
+    if (owner != this) {
+      local = new ring();
+      local->events = (trace_event_t*) calloc(ring_mask + 1, sizeof(trace_event_t));
+      local->recorded = 0;
+      local->next_task = 0;
+      pthread_mutex_lock(&rings_mutex);
+      local->index = ring_count++;
+      local->next = rings;
+      rings = local;
+      pthread_mutex_unlock(&rings_mutex);
+      owner = this;
+    }
+    return local;
+  }
+
+  std::vector<task_times> collect() const {
+    // Calibrate ticks against the clock over the recorder's whole lifetime
+    uint64_t ticks = trace_ticks(), ns = trace_clock_ns();
+    double ns_per_tick = (ticks > origin_ticks) ? (double) (ns - origin_ns) / (ticks - origin_ticks) : 1.0;
+    std::unordered_map<uint64_t, size_t> by_id;
+    std::vector<task_times> tasks;
+    for (ring* r = rings; r != nullptr; r = r->next) {
+      uint64_t first = (r->recorded > ring_mask + 1) ? r->recorded - (ring_mask + 1) : 0;
+      for (uint64_t i = first; i < r->recorded; i++) {
+        const trace_event_t& e = r->events[i & ring_mask];
+        auto found = by_id.find(e.task_id);
+        if (found == by_id.end()) {
+          found = by_id.emplace(e.task_id, tasks.size()).first;
+          tasks.push_back(task_times{e.task_id, e.kernel_id, e.app_instance, -1, 0, 0, 0, 0});
+        }
+        task_times& t = tasks[found->second];
+        uint64_t timestamp_ns = origin_ns + (uint64_t) ((double) (e.timestamp - origin_ticks) * ns_per_tick);
+        switch (e.type) {
+          case TRACE_ENQUEUE: t.enqueue = timestamp_ns; break;
+          case TRACE_START: t.start = timestamp_ns; t.worker = e.worker; break;
+          case TRACE_END: t.end = timestamp_ns; break;
+          case TRACE_COMPLETE: t.complete = timestamp_ns; break;
+        }
+      }
+    }
+    return tasks;
+  }
+
+  const uint64_t ring_mask;
+  pthread_mutex_t rings_mutex;
+  ring* rings;
+  uint64_t ring_count;
+  // When the recorder was created, in ticks and in nanoseconds
+  const uint64_t origin_ticks, origin_ns;
+};